@@ -8,6 +8,7 @@
  */
 
 #include "attractor.h"
+#include <cstring>
 
 const double attractor::point_color[4] = {0.0, 0.0, 0.0, 0.8};
 const double attractor::neighbor_color[4] = {0.0, 0.4, 0.8, 0.8};
@@ -18,6 +19,7 @@ const double attractor::LAG2_SAT = 0.4;
 const double attractor::LINE_WIDTH = 0.6;
 const double attractor::SMALL_LINE_WIDTH = 1.0;
 const double attractor::POINT_WIDTH = 9.0;
+const double attractor::LOD_PIXEL_ERROR = 0.5;
 const double attractor::sigma = 10;
 const double attractor::rho = 28;
 const double attractor::beta = 8.0/3;
@@ -27,6 +29,45 @@ const double attractor::draw_fraction = 0.2;
 const double attractor::init_distance = 6;
 const double attractor::xmap_attractor_scale = 0.60;
 
+// same colors as col(), with the current point as a uniform so nothing is
+// recomputed per vertex on the CPU when it moves; vertex shaders are written in
+// the dialect of renderer.h, which runs on either context profile
+static const char* embedding_vertex_shader =
+    "uniform vec3 current_point;\n"
+    "uniform bool color_method;\n"
+    "uniform float d;\n"
+    "void main()\n"
+    "{\n"
+    "    float sat;\n"
+    "    gl_Position = projection_modelview * vec4(position, 1.0);\n"
+    "    if(color_method)\n"
+    "    {\n"
+    "        sat = exp(-8.0*d * distance(position, current_point));\n"
+    "        vertex_color = vec4(0.0, 0.0, 0.0, sat);\n"
+    "    }\n"
+    "    else\n"
+    "    {\n"
+    "        sat = position.x - d + (1.0-d);\n"
+    "        vertex_color = vec4(sat, sat, sat, 1.0);\n"
+    "    }\n"
+    "}\n";
+
+// time series vertices are (sample, value), mapped to the panel's time axis by
+// project_t = sample * time_transform.x + time_transform.y; samples after the
+// current point fade with project_t as in the immediate mode panels
+static const char* series_vertex_shader =
+    "uniform vec2 time_transform;\n"
+    "uniform bool fade;\n"
+    "uniform float sat;\n"
+    "void main()\n"
+    "{\n"
+    "    float project_t = position.x * time_transform.x + time_transform.y;\n"
+    "    gl_Position = projection_modelview * vec4(project_t, position.y, 0.0, 1.0);\n"
+    "    vertex_color = color;\n"
+    "    if(fade)\n"
+    "        vertex_color.rgb = clamp(color.rgb + project_t/8.0 + 0.75*sat, 0.0, 1.0);\n"
+    "}\n";
+
 bool operator < (const texture_label & a, const texture_label & b)
 {
 	return a.z_pos < b.z_pos;
@@ -36,12 +77,20 @@ attractor::attractor(const int max_frames)
 {
     // initialize switches
     lorenz_sim_mode = EULER;
+    nn_method = NN_GRID;
+    MORTON_ORDER = true;
     DRAW_CONE = true;
 	DEBUG = false;
     TSVIEW = false;
     COLOR_METHOD = false;
     MANIFOLD_LABEL = true;
     SPLIT_VIEW = false;
+    SKILL_HUD = true;
+    VERTEX_BUFFERS = false;
+    render = NULL;
+    embedding_program = 0;
+    series_program = 0;
+    TRAIL_BUFFERS = false;
 	x_tracer = NONE;
 	y_tracer = NONE;
 	z_tracer = NONE;
@@ -61,14 +110,49 @@ attractor::attractor(const int max_frames)
     x_lag = 0;
     y_lag = 1;
     z_lag = 2;
-    nn_num = 4;
-    nn_skip = 5;
+    ccm.tau = tau;
+    ccm.tp = tp;
+    ccm.nn_num = 4;
+    ccm.nn_skip = 5;
+    next_tau = ccm.tau;
+    next_nn_num = ccm.nn_num;
+    next_nn_skip = ccm.nn_skip;
     
 	// initialize vectors
 	num_points = max_frames;
 	x.resize(num_points);
     y.resize(num_points);
     z.resize(num_points);
+    ccm.resize(num_points);
+    
+    // Bernstein polynomials of the cubic connecting curves at each segment end
+    for(int i = 0; i <= CURVE_SEGMENTS; i++)
+    {
+        double u = double(i) / CURVE_SEGMENTS;
+        bezier_basis[i][0] = (1-u)*(1-u)*(1-u);
+        bezier_basis[i][1] = 3*u*(1-u)*(1-u);
+        bezier_basis[i][2] = 3*u*u*(1-u);
+        bezier_basis[i][3] = u*u*u;
+    }
+    
+    // initialize background rebuild
+    rebuild_running = false;
+    rebuild_ready = false;
+    rebuild_cancel = false;
+    pthread_mutex_init(&rebuild_mutex, NULL);
+    
+    skill_frame = 0;
+}
+
+attractor::~attractor()
+{
+    stop_rebuild();
+    pthread_mutex_destroy(&rebuild_mutex);
+    delete render;
+}
+
+void ccm_data::resize(const int num_points)
+{
     x_nn_indices.resize(num_points);
     x_nn_weights.resize(num_points);
     y_nn_indices.resize(num_points);
@@ -92,10 +176,37 @@ attractor::attractor(const int max_frames)
     z_forecast.resize(num_points, 0);
     z_forecast_lag_1.resize(num_points, 0);
     z_forecast_lag_2.resize(num_points, 0);
+    return;
 }
 
-attractor::~attractor()
+void ccm_data::swap(ccm_data & other)
 {
+    std::swap(tau, other.tau);
+    std::swap(tp, other.tp);
+    std::swap(nn_num, other.nn_num);
+    std::swap(nn_skip, other.nn_skip);
+    x_nn_indices.swap(other.x_nn_indices);
+    x_nn_weights.swap(other.x_nn_weights);
+    y_nn_indices.swap(other.y_nn_indices);
+    y_nn_weights.swap(other.y_nn_weights);
+    z_nn_indices.swap(other.z_nn_indices);
+    z_nn_weights.swap(other.z_nn_weights);
+    x_xmap_y.swap(other.x_xmap_y);
+    x_xmap_z.swap(other.x_xmap_z);
+    y_xmap_x.swap(other.y_xmap_x);
+    y_xmap_z.swap(other.y_xmap_z);
+    z_xmap_x.swap(other.z_xmap_x);
+    z_xmap_y.swap(other.z_xmap_y);
+    x_forecast.swap(other.x_forecast);
+    x_forecast_lag_1.swap(other.x_forecast_lag_1);
+    x_forecast_lag_2.swap(other.x_forecast_lag_2);
+    y_forecast.swap(other.y_forecast);
+    y_forecast_lag_1.swap(other.y_forecast_lag_1);
+    y_forecast_lag_2.swap(other.y_forecast_lag_2);
+    z_forecast.swap(other.z_forecast);
+    z_forecast_lag_1.swap(other.z_forecast_lag_1);
+    z_forecast_lag_2.swap(other.z_forecast_lag_2);
+    return;
 }
 
 void attractor::draw_takens()
@@ -106,10 +217,8 @@ void attractor::draw_takens()
     
     texture_2d curr_texture = my_textures[TAKENS_THEOREM_TEXTURE];
     
-    glBindTexture(GL_TEXTURE_2D, curr_texture.texture_id);
-    
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
     if(0.75*window_width > window_height)
     {
         low_x = -1.5*window_width/window_height;
@@ -124,9 +233,9 @@ void attractor::draw_takens()
         low_y = -2.0*window_height/window_width;
         high_y = 2.0*window_height/window_width;
     }
-    glOrtho(low_x, high_x, low_y, high_y, -1.5, 1.5);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    matrices.ortho(low_x, high_x, low_y, high_y, -1.5, 1.5);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
     
     if(curr_texture.height > curr_texture.width*0.75)
     {
@@ -137,36 +246,35 @@ void attractor::draw_takens()
         scale = 2.0 / curr_texture.width;
     }
     
-    glColor3d(1.0, 1.0, 1.0);
-    glEnable(GL_TEXTURE_2D);
-    glBegin(GL_QUADS);
-    glNormal3f(0.0, 0.0, 1.0);
-    glTexCoord2d(0.0, 0.0); glVertex3d(-curr_texture.width*scale, -curr_texture.height*scale, depth);
-    glTexCoord2d(0.0, 1.0); glVertex3d(-curr_texture.width*scale, curr_texture.height*scale, depth);
-    glTexCoord2d(1.0, 1.0); glVertex3d(curr_texture.width*scale, curr_texture.height*scale, depth);
-    glTexCoord2d(1.0, 0.0); glVertex3d(curr_texture.width*scale, -curr_texture.height*scale, depth);
-    glEnd();
-    glDisable(GL_TEXTURE_2D);
+    render->color(1.0, 1.0, 1.0);
+    render->texture(curr_texture.texture_id);
+    render->begin(GL_QUADS);
+    render->tex_coord(curr_texture.u0, curr_texture.v0); render->vertex(-curr_texture.width*scale, -curr_texture.height*scale, depth);
+    render->tex_coord(curr_texture.u0, curr_texture.v1); render->vertex(-curr_texture.width*scale, curr_texture.height*scale, depth);
+    render->tex_coord(curr_texture.u1, curr_texture.v1); render->vertex(curr_texture.width*scale, curr_texture.height*scale, depth);
+    render->tex_coord(curr_texture.u1, curr_texture.v0); render->vertex(curr_texture.width*scale, -curr_texture.height*scale, depth);
+    render->end();
+    render->texture(0);
     
     return;
 }
 
 void attractor::draw_xmap_ts(const int frame)
 {	
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
     
     if(0.75*window_width > window_height)
     {
-        glOrtho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
+        matrices.ortho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
     }
     else
     {
-        glOrtho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
+        matrices.ortho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
     }
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
     
     double ts_delta_x = 0.8, delta_x, delta_y = 1.1;
     draw_xmap_generic(frame, pred_dim, lag_dim, -1, true);
@@ -176,51 +284,51 @@ void attractor::draw_xmap_ts(const int frame)
     {
         case 1:
             if(pred_dim == 2)
-                prediction_ts = &x_xmap_y;
+                prediction_ts = &ccm.x_xmap_y;
             else
-                prediction_ts = &x_xmap_z;
+                prediction_ts = &ccm.x_xmap_z;
             break;
         case 2:
             if(pred_dim == 1)
-                prediction_ts = &y_xmap_x;
+                prediction_ts = &ccm.y_xmap_x;
             else
-                prediction_ts = &y_xmap_z;
+                prediction_ts = &ccm.y_xmap_z;
             break;
         case 3:
             if(pred_dim == 2)
-                prediction_ts = &z_xmap_y;
+                prediction_ts = &ccm.z_xmap_y;
             else
-                prediction_ts = &z_xmap_x;
+                prediction_ts = &ccm.z_xmap_x;
             break;
     }
     
     x_scale = 1.0;
     y_scale = xmap_attractor_scale;
     z_scale = xmap_attractor_scale;
-    glPushMatrix();
-    glTranslated(ts_delta_x*x_scale, (delta_y-d)*y_scale-0.1, 0);
+    matrices.push();
+    matrices.translate(ts_delta_x*x_scale, (delta_y-d)*y_scale-0.1, 0);
     draw_xmap_ts(frame, 0, 0, pred_dim, 1.0, 1.0, prediction_ts);
-    glPopMatrix();
+    matrices.pop();
     
 	return;
 }
 
 void attractor::draw_xmap(const int frame)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
     
     if(0.75*window_width > window_height)
     {
-        glOrtho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
+        matrices.ortho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
     }
     else
     {
-        glOrtho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
+        matrices.ortho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
     }
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
     
     draw_xmap_generic(frame, 0, lag_dim, pred_dim, false);
     return;
@@ -228,20 +336,20 @@ void attractor::draw_xmap(const int frame)
 
 void attractor::draw_univariate_ts(const int frame)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
     
     if(0.75*window_width > window_height)
     {
-        glOrtho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
+        matrices.ortho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
     }
     else
     {
-        glOrtho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
+        matrices.ortho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
     }
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
     
     vector<double>* ts;
     double ts_delta_x = 0.8, delta_x = 1.8;
@@ -259,28 +367,28 @@ void attractor::draw_univariate_ts(const int frame)
 	{
 		case 1:
 			ts = &x;
-            nn_indices = x_nn_indices[frame];
-            pred_y_iter = x_forecast.begin();
-            pred_x_iter = x_forecast_lag_1.begin();
-            pred_z_iter = x_forecast_lag_2.begin();
+            nn_indices = ccm.x_nn_indices[frame];
+            pred_y_iter = ccm.x_forecast.begin();
+            pred_x_iter = ccm.x_forecast_lag_1.begin();
+            pred_z_iter = ccm.x_forecast_lag_2.begin();
             r = 1.0;
             texture_index = X_LABEL_TEXTURE;
             break;
 		case 2:
 			ts = &y;
-            nn_indices = y_nn_indices[frame];
-            pred_y_iter = y_forecast.begin();
-            pred_x_iter = y_forecast_lag_1.begin();
-            pred_z_iter = y_forecast_lag_2.begin();
+            nn_indices = ccm.y_nn_indices[frame];
+            pred_y_iter = ccm.y_forecast.begin();
+            pred_x_iter = ccm.y_forecast_lag_1.begin();
+            pred_z_iter = ccm.y_forecast_lag_2.begin();
             g = 1.0;
             texture_index = Y_LABEL_TEXTURE;
 			break;
 		case 3:
 			ts = &z;
-            nn_indices = z_nn_indices[frame];
-            pred_y_iter = z_forecast.begin();
-            pred_x_iter = z_forecast_lag_1.begin();
-            pred_z_iter = z_forecast_lag_2.begin();
+            nn_indices = ccm.z_nn_indices[frame];
+            pred_y_iter = ccm.z_forecast.begin();
+            pred_x_iter = ccm.z_forecast_lag_1.begin();
+            pred_z_iter = ccm.z_forecast_lag_2.begin();
             b = 1.0;
             texture_index = Z_LABEL_TEXTURE;
 			break;
@@ -293,119 +401,104 @@ void attractor::draw_univariate_ts(const int frame)
     x_scale = xmap_attractor_scale;
     y_scale = xmap_attractor_scale;
     z_scale = xmap_attractor_scale;
-    glPushMatrix();
+    matrices.push();
     
-    glTranslated(-delta_x*x_scale, 0, 0);
-    glRotated(theta, 0, 1, 0);
-    glTranslated(-d*x_scale, -d*y_scale, -d*z_scale);
+    matrices.translate(-delta_x*x_scale, 0, 0);
+    matrices.rotate(theta, 0, 1, 0);
+    matrices.translate(-d*x_scale, -d*y_scale, -d*z_scale);
     
     // axes
     draw_axis(2, r, g, b, 0, texture_index+1, 0);
     draw_axis(1, r*LAG_SAT, g*LAG_SAT, b*LAG_SAT, 0.5, texture_index+2, 1);
     draw_axis(3, r*LAG2_SAT, g*LAG2_SAT, b*LAG2_SAT, 1, texture_index+3, 2);
     
-    glPushMatrix();
+    matrices.push();
     
-    glScaled(x_scale, y_scale, z_scale);
+    matrices.scale(x_scale, y_scale, z_scale);
     
     if(MANIFOLD_LABEL)
         enqueue_label(d, 2*d, 2*d, M_LABEL_TEXTURE+lag_dim, texture_scale, 1, 0);
     
     // draw attractor
-    glLineWidth(scale * LINE_WIDTH);
-    draw_embedding(ts->begin()+tau, ts->begin()+2*tau, ts->begin(), frame-2*tau);
+    draw_embedding(ts->begin()+tau, ts->begin()+2*tau, ts->begin(), frame-2*tau, scale * LINE_WIDTH);
     
    	// draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(*(ts->begin() + frame-1-tau), *(ts->begin() + frame-1), *(ts->begin() + frame-1-2*tau));
-	glEnd();
+    enqueue_marker(*(ts->begin() + frame-1-tau), *(ts->begin() + frame-1), *(ts->begin() + frame-1-2*tau), point_color, POINT_WIDTH*scale);
 	
     if(nn_indices.size() == 0)
         return;
     
     // neighbors
-    glColor4dv(neighbor_color);
     for(vector<int>::iterator nn_index = nn_indices.begin(); nn_index != nn_indices.end(); nn_index++)
-    {
-        glBegin(GL_POINTS);
-        glVertex3d(*(ts->begin() + *nn_index-1-tau), *(ts->begin() + *nn_index-1), *(ts->begin() + *nn_index-1-2*tau));
-        glEnd();
-    }
+        enqueue_marker(*(ts->begin() + *nn_index-1-tau), *(ts->begin() + *nn_index-1), *(ts->begin() + *nn_index-1-2*tau),
+                       neighbor_color, POINT_WIDTH*scale);
     
-    glPopMatrix();
+    matrices.pop();
     
     if(DEBUG)
     {
-        glPushMatrix();
-        glScaled(x_scale, y_scale, z_scale);
-        glColor4dv(neighbor_color);
+        matrices.push();
+        matrices.scale(x_scale, y_scale, z_scale);
+        render->color(neighbor_color);
         
         // neighbor trajectories
-        glLineWidth(scale * LINE_WIDTH * 1.5);
+        render->line_width(scale * LINE_WIDTH * 1.5);
         for(vector<int>::iterator nn_index = nn_indices.begin(); nn_index != nn_indices.end(); nn_index++)
         {
-            glBegin(GL_LINE_STRIP);
+            render->begin(GL_LINE_STRIP);
             for(int k = 0; k <= tp; k++)
             {
-                glVertex3d(*(ts->begin() + *nn_index-1+k-tau), *(ts->begin() + *nn_index-1+k), *(ts->begin() + *nn_index-1-2*tau+k));
+                render->vertex(*(ts->begin() + *nn_index-1+k-tau), *(ts->begin() + *nn_index-1+k), *(ts->begin() + *nn_index-1-2*tau+k));
             }
-            glEnd();
+            render->end();
         }
         
         // neighbor forward points
-        glColor4d(lag_dim == 1, lag_dim == 2, lag_dim == 3, 0.5);
         for(vector<int>::iterator nn_index = nn_indices.begin(); nn_index != nn_indices.end(); nn_index++)
-        {
-            glBegin(GL_POINTS);
-            glVertex3d(*(ts->begin() + *nn_index-1-tau+tp), *(ts->begin() + *nn_index-1+tp), *(ts->begin() + *nn_index-1-2*tau+tp));
-            glEnd();
-        }
+            enqueue_marker(*(ts->begin() + *nn_index-1-tau+tp), *(ts->begin() + *nn_index-1+tp), *(ts->begin() + *nn_index-1-2*tau+tp),
+                           lag_dim == 1, lag_dim == 2, lag_dim == 3, 0.5, POINT_WIDTH*scale);
         
         // draw forecast
-        glColor4dv(pred_color);
-        glBegin(GL_POINTS);
-        glVertex3d(*(pred_x_iter+frame+tp-1), *(pred_y_iter+frame+tp-1), *(pred_z_iter+frame+tp-1));
-        glEnd();
+        enqueue_marker(*(pred_x_iter+frame+tp-1), *(pred_y_iter+frame+tp-1), *(pred_z_iter+frame+tp-1), pred_color, POINT_WIDTH*scale);
+        render->color(pred_color);
         
-        glBegin(GL_LINE_STRIP);
+        render->begin(GL_LINE_STRIP);
         for(int k = 0; k <= tp; k++)
         {
-            glVertex3d(*(pred_x_iter+frame+k-1), *(pred_y_iter+frame+k-1), *(pred_z_iter+frame+k-1));
+            render->vertex(*(pred_x_iter+frame+k-1), *(pred_y_iter+frame+k-1), *(pred_z_iter+frame+k-1));
         }
-        glEnd();
+        render->end();
         
-        glPopMatrix();
+        matrices.pop();
     }
     
-    glPopMatrix();
+    matrices.pop();
     
 	// ***** TIME SERIES *****
     x_scale = 1.0;
     y_scale = xmap_attractor_scale;
     z_scale = xmap_attractor_scale;
-    glPushMatrix();
-    glTranslated(ts_delta_x, (-d)*y_scale, 0);
+    matrices.push();
+    matrices.translate(ts_delta_x, (-d)*y_scale, 0);
     draw_ts(frame, 0, 2*tau, lag_dim, 1.0, 0);
     if(DEBUG)
     {
         switch(lag_dim)
         {
             case 1:
-                draw_univariate_ts(frame, &x_forecast);
+                draw_univariate_ts(frame, &ccm.x_forecast);
                 break;
             case 2:
-                draw_univariate_ts(frame, &y_forecast);
+                draw_univariate_ts(frame, &ccm.y_forecast);
                 break;
             case 3:
-                draw_univariate_ts(frame, &z_forecast);
+                draw_univariate_ts(frame, &ccm.z_forecast);
                 break;
         }
     }
-    //draw_xmap_ts(frame, 0, 0, lag_dim, 1.0, 1.0, &x_forecast);
+    //draw_xmap_ts(frame, 0, 0, lag_dim, 1.0, 1.0, &ccm.x_forecast);
     
-    glPopMatrix();
+    matrices.pop();
     
     
     // ***** PROJECTION LINES *****
@@ -414,20 +507,20 @@ void attractor::draw_univariate_ts(const int frame)
         x_scale = xmap_attractor_scale;
         y_scale = xmap_attractor_scale;
         z_scale = xmap_attractor_scale;
-        glPushMatrix();
-        glScaled(x_scale, y_scale, z_scale);
-        glTranslated(-delta_x, 0, 0);
-        glRotated(theta, 0, 1, 0);
-        glTranslated(-d, -d, -d);
+        matrices.push();
+        matrices.scale(x_scale, y_scale, z_scale);
+        matrices.translate(-delta_x, 0, 0);
+        matrices.rotate(theta, 0, 1, 0);
+        matrices.translate(-d, -d, -d);
         
-        glColor4dv(pred_color);
-        glLineWidth(scale * LINE_WIDTH);
-        glBegin(GL_LINES);
-        glVertex3d(*(pred_x_iter+frame+tp-1), *(pred_y_iter+frame+tp-1), *(pred_z_iter+frame+tp-1));
-        glVertex3d(project_dist*cos(theta/180*PI)+d+tp*2.0 / num_points / draw_fraction / x_scale, *(pred_y_iter+frame+tp-1), project_dist*sin(theta/180*PI)+d);
-        glEnd();
+        render->color(pred_color);
+        render->line_width(scale * LINE_WIDTH);
+        render->begin(GL_LINES);
+        render->vertex(*(pred_x_iter+frame+tp-1), *(pred_y_iter+frame+tp-1), *(pred_z_iter+frame+tp-1));
+        render->vertex(project_dist*cos(theta/180*PI)+d+tp*2.0 / num_points / draw_fraction / x_scale, *(pred_y_iter+frame+tp-1), project_dist*sin(theta/180*PI)+d);
+        render->end();
         
-        glPopMatrix();
+        matrices.pop();
     }
     
     return;
@@ -436,13 +529,13 @@ void attractor::draw_univariate_ts(const int frame)
 
 void attractor::draw_univariate(const int frame)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
-    glTranslated(0, init_distance, 0);    
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
+    matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
+    matrices.translate(0, init_distance, 0);    
     
     vector<double>* ts;
     vector<int> nn_indices;
@@ -451,95 +544,81 @@ void attractor::draw_univariate(const int frame)
     x_scale = 1.0;
     y_scale = 1.0;
     z_scale = 1.0;
-	glTranslated(-d, -d, -d);
+	matrices.translate(-d, -d, -d);
 	
 	switch(lag_dim)
 	{
 		case 1:
 			ts = &x;
-            nn_indices = x_nn_indices[frame];
-            pred_x_iter = x_forecast.begin();
-            pred_y_iter = x_forecast_lag_1.begin();
-            pred_z_iter = x_forecast_lag_2.begin();
+            nn_indices = ccm.x_nn_indices[frame];
+            pred_x_iter = ccm.x_forecast.begin();
+            pred_y_iter = ccm.x_forecast_lag_1.begin();
+            pred_z_iter = ccm.x_forecast_lag_2.begin();
 			break;
 		case 2:
 			ts = &y;
-            nn_indices = y_nn_indices[frame];
-            pred_x_iter = y_forecast.begin();
-            pred_y_iter = y_forecast_lag_1.begin();
-            pred_z_iter = y_forecast_lag_2.begin();
+            nn_indices = ccm.y_nn_indices[frame];
+            pred_x_iter = ccm.y_forecast.begin();
+            pred_y_iter = ccm.y_forecast_lag_1.begin();
+            pred_z_iter = ccm.y_forecast_lag_2.begin();
 			break;
 		case 3:
 			ts = &z;
-            nn_indices = z_nn_indices[frame];
-            pred_x_iter = z_forecast.begin();
-            pred_y_iter = z_forecast_lag_1.begin();
-            pred_z_iter = z_forecast_lag_2.begin();
+            nn_indices = ccm.z_nn_indices[frame];
+            pred_x_iter = ccm.z_forecast.begin();
+            pred_y_iter = ccm.z_forecast_lag_1.begin();
+            pred_z_iter = ccm.z_forecast_lag_2.begin();
 			break;
 	}
 	
 	// draw attractor
-    glLineWidth(scale * LINE_WIDTH);
-    draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau);
+    draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau, scale * LINE_WIDTH);
     
     if(MANIFOLD_LABEL)
         enqueue_label(d, d, 2*d, M_LABEL_TEXTURE+lag_dim, texture_scale, 1, 0);
     
 	// draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(*(ts->begin() + frame-1), *(ts->begin() + frame-1-tau), *(ts->begin() + frame-1-2*tau));
-	glEnd();
+    enqueue_marker(*(ts->begin() + frame-1), *(ts->begin() + frame-1-tau), *(ts->begin() + frame-1-2*tau), point_color, POINT_WIDTH*scale);
 	
 	draw_axes(true, lag_dim);
     
     if(nn_indices.size() == 0)
         return;
     
-    glColor4dv(neighbor_color);
+    render->color(neighbor_color);
     for(vector<int>::iterator nn_index = nn_indices.begin(); nn_index != nn_indices.end(); nn_index++)
-    {
-        glBegin(GL_POINTS);
-        glVertex3d(*(ts->begin() + *nn_index-1), *(ts->begin() + *nn_index-1-tau), *(ts->begin() + *nn_index-1-2*tau));
-        glEnd();
-    }
+        enqueue_marker(*(ts->begin() + *nn_index-1), *(ts->begin() + *nn_index-1-tau), *(ts->begin() + *nn_index-1-2*tau),
+                       neighbor_color, POINT_WIDTH*scale);
     
     if(DEBUG)
     {
         // draw trajectories
-        glLineWidth(scale * LINE_WIDTH * 1.5);
+        render->line_width(scale * LINE_WIDTH * 1.5);
         for(vector<int>::iterator nn_index = nn_indices.begin(); nn_index != nn_indices.end(); nn_index++)
         {
-            glBegin(GL_LINE_STRIP);
+            render->begin(GL_LINE_STRIP);
             for(int k = 0; k <= tp; k++)
             {
-                glVertex3d(*(ts->begin() + *nn_index-1+k), *(ts->begin() + *nn_index-1-tau+k), *(ts->begin() + *nn_index-1-2*tau+k));
+                render->vertex(*(ts->begin() + *nn_index-1+k), *(ts->begin() + *nn_index-1-tau+k), *(ts->begin() + *nn_index-1-2*tau+k));
             }
-            glEnd();
+            render->end();
         }
         
         // draw projected neighbors
-        glColor4d(lag_dim == 1, lag_dim == 2, lag_dim == 3, 0.5);
         for(vector<int>::iterator nn_index = nn_indices.begin(); nn_index != nn_indices.end(); nn_index++)
-        {
-            glBegin(GL_POINTS);
-            glVertex3d(*(ts->begin() + *nn_index-1+tp), *(ts->begin() + *nn_index-1-tau+tp), *(ts->begin() + *nn_index-1-2*tau+tp));
-            glEnd();
-        }
+            enqueue_marker(*(ts->begin() + *nn_index-1+tp), *(ts->begin() + *nn_index-1-tau+tp), *(ts->begin() + *nn_index-1-2*tau+tp),
+                           lag_dim == 1, lag_dim == 2, lag_dim == 3, 0.5, POINT_WIDTH*scale);
         
         // draw forecast
-        glColor4dv(pred_color);
-        glBegin(GL_POINTS);
-        glVertex3d(*(pred_x_iter+frame+tp-1), *(pred_y_iter+frame+tp-1), *(pred_z_iter+frame+tp-1));
-        glEnd();
+        enqueue_marker(*(pred_x_iter+frame+tp-1), *(pred_y_iter+frame+tp-1), *(pred_z_iter+frame+tp-1), pred_color, POINT_WIDTH*scale);
+        render->color(pred_color);
         
-        glBegin(GL_LINE_STRIP);
+        render->begin(GL_LINE_STRIP);
         for(int k = 0; k <= tp; k++)
         {
-            glVertex3d(*(pred_x_iter+frame+k-1), *(pred_y_iter+frame+k-1), *(pred_z_iter+frame+k-1));
+            render->vertex(*(pred_x_iter+frame+k-1), *(pred_y_iter+frame+k-1), *(pred_z_iter+frame+k-1));
         }
-        glEnd();
+        render->end();
     }
     
 	return;
@@ -547,20 +626,20 @@ void attractor::draw_univariate(const int frame)
 
 void attractor::draw_shadow(const int frame)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
-    glTranslated(0, init_distance, 0);
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
+    matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
+    matrices.translate(0, init_distance, 0);
     
 	vector<double>* ts;
     double sep = 1.4;
     vector<int>nn_indices;
     int nn_index;
     
-	glTranslated(-d, -d, -d+.8);
+	matrices.translate(-d, -d, -d+.8);
 	switch(lag_dim)
 	{
 		case 1:
@@ -574,17 +653,12 @@ void attractor::draw_shadow(const int frame)
 			break;
 	}
 	// draw attractor
-    glLineWidth(scale * LINE_WIDTH);
-    draw_embedding(x.begin(), y.begin(), z.begin(), frame);
+    draw_embedding(x.begin(), y.begin(), z.begin(), frame, scale * LINE_WIDTH);
     if(MANIFOLD_LABEL)
         enqueue_label(0, 0, d, M_LABEL_TEXTURE, texture_scale, 1, 0);
     
 	// draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(x[frame-1], y[frame-1], z[frame-1]);
-	glEnd();
+    enqueue_marker(x[frame-1], y[frame-1], z[frame-1], point_color, POINT_WIDTH*scale);
     if(TSVIEW)
     {
         draw_axes(false, 0);
@@ -596,12 +670,11 @@ void attractor::draw_shadow(const int frame)
     // draw line connecting attractors
     draw_curve(x[frame-1], y[frame-1], z[frame-1], *(ts->begin() + frame-1), *(ts->begin() + frame-1-tau), *(ts->begin() + frame-1-2*tau)-sep);
     
-    glPushMatrix();
-	glTranslated(0, 0, -sep);
+    matrices.push();
+	matrices.translate(0, 0, -sep);
 	
 	// draw shadow attractor
-    glLineWidth(scale * LINE_WIDTH);
-    draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau);
+    draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau, scale * LINE_WIDTH);
     
     if(TSVIEW)
     {
@@ -611,48 +684,39 @@ void attractor::draw_shadow(const int frame)
         enqueue_label(d*0.35, 0, d, M_LABEL_TEXTURE+lag_dim, texture_scale, 1, 0);
 	
 	// draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(*(ts->begin() + frame-1), *(ts->begin() + frame-1-tau), *(ts->begin() + frame-1-2*tau));
-	glEnd();
+    enqueue_marker(*(ts->begin() + frame-1), *(ts->begin() + frame-1-tau), *(ts->begin() + frame-1-2*tau), point_color, POINT_WIDTH*scale);
 	
     // find index of nearest neighbor
     switch(lag_dim)
 	{
 		case 1:
-            nn_indices = x_nn_indices[frame];
+            nn_indices = ccm.x_nn_indices[frame];
 			break;
 		case 2:
-            nn_indices = y_nn_indices[frame];
+            nn_indices = ccm.y_nn_indices[frame];
 			break;
 		case 3:
-            nn_indices = z_nn_indices[frame];
+            nn_indices = ccm.z_nn_indices[frame];
 			break;
 	}
     if(nn_indices.size() == 0)
     {
-        glPopMatrix();
+        matrices.pop();
         return;
     }
     
     nn_index = nn_indices[0];    
     if(DEBUG)
     {
-        glColor4dv(neighbor_color);
-        glBegin(GL_POINTS);
-        glVertex3d(x[nn_index-1], y[nn_index-1], z[nn_index-1]+sep);
-        glEnd();
+        enqueue_marker(x[nn_index-1], y[nn_index-1], z[nn_index-1]+sep, neighbor_color, POINT_WIDTH*scale);
         
         draw_curve(x[nn_index-1], y[nn_index-1], z[nn_index-1]+sep, *(ts->begin() + nn_index-1), *(ts->begin() + nn_index-1-tau), *(ts->begin() + nn_index-1-2*tau));
         
-        glColor4dv(neighbor_color);
-        glBegin(GL_POINTS);
-        glVertex3d(*(ts->begin() + nn_index-1), *(ts->begin() + nn_index-1-tau), *(ts->begin() + nn_index-1-2*tau));
-        glEnd();
+        enqueue_marker(*(ts->begin() + nn_index-1), *(ts->begin() + nn_index-1-tau), *(ts->begin() + nn_index-1-2*tau),
+                       neighbor_color, POINT_WIDTH*scale);
     }
     
-	glPopMatrix();
+	matrices.pop();
     
     
     
@@ -661,19 +725,19 @@ void attractor::draw_shadow(const int frame)
 
 void attractor::draw_reconstruction(const int frame)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
-    glTranslated(0, init_distance, 0);    
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
+    matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
+    matrices.translate(0, init_distance, 0);    
     
 	vector<double>* ts;
     x_scale = 1.0;
     y_scale = 1.0;
     z_scale = 1.0;
-	glTranslated(-d, -d, -d);
+	matrices.translate(-d, -d, -d);
 	
 	switch(lag_dim)
 	{
@@ -689,18 +753,13 @@ void attractor::draw_reconstruction(const int frame)
 	}
 	
 	// draw attractor
-    glLineWidth(scale * LINE_WIDTH);
-    draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau);
+    draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau, scale * LINE_WIDTH);
     
     if(MANIFOLD_LABEL)
         enqueue_label(d, d, 2*d, M_LABEL_TEXTURE+lag_dim, texture_scale, 1, 0);
     
 	// draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(*(ts->begin() + frame-1), *(ts->begin() + frame-1-tau), *(ts->begin() + frame-1-2*tau));
-	glEnd();
+    enqueue_marker(*(ts->begin() + frame-1), *(ts->begin() + frame-1-tau), *(ts->begin() + frame-1-2*tau), point_color, POINT_WIDTH*scale);
 	
 	draw_axes(true, lag_dim);
 	return;
@@ -708,13 +767,13 @@ void attractor::draw_reconstruction(const int frame)
 
 void attractor::draw_generic_reconstruction(const int frame)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
-    glTranslated(0, init_distance, 0);
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
+    matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
+    matrices.translate(0, init_distance, 0);
     
 	vector<double>* ts_x;
     vector<double>* ts_y;
@@ -722,7 +781,7 @@ void attractor::draw_generic_reconstruction(const int frame)
     x_scale = 1.0;
     y_scale = 1.0;
     z_scale = 1.0;
-	glTranslated(-d, -d, -d);
+	matrices.translate(-d, -d, -d);
 	
 	switch(x_dim)
 	{
@@ -762,15 +821,10 @@ void attractor::draw_generic_reconstruction(const int frame)
 	}
 	
 	// draw attractor
-    glLineWidth(scale * LINE_WIDTH);
-    draw_embedding(ts_x->begin()+x_lag*tau, ts_y->begin()+y_lag*tau, ts_z->begin()+z_lag*tau, frame-2*tau);
+    draw_embedding(ts_x->begin()+x_lag*tau, ts_y->begin()+y_lag*tau, ts_z->begin()+z_lag*tau, frame-2*tau, scale * LINE_WIDTH);
     
 	// draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(*(ts_x->begin() + frame-1-2*tau+x_lag*tau), *(ts_y->begin() + frame-1-2*tau+y_lag*tau), *(ts_z->begin() + frame-1-2*tau+z_lag*tau));
-	glEnd();
+    enqueue_marker(*(ts_x->begin() + frame-1-2*tau+x_lag*tau), *(ts_y->begin() + frame-1-2*tau+y_lag*tau), *(ts_z->begin() + frame-1-2*tau+z_lag*tau), point_color, POINT_WIDTH*scale);
 	
     draw_lag_axis(1, x_dim, x_lag);
     draw_lag_axis(2, y_dim, y_lag);
@@ -786,18 +840,18 @@ void attractor::draw_lagged_time_series(const int frame)
     if(SPLIT_VIEW)
     {
         // draw small attractor
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-        glMultMatrixd(rot_matrix);
-        glTranslated(1, init_distance, 0);
+        matrices.mode(GL_PROJECTION);
+        matrices.load_identity();
+        matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+        matrices.mode(GL_MODELVIEW);
+        matrices.load_identity();
+        matrices.mult(rot_matrix);
+        matrices.translate(1, init_distance, 0);
         
         x_scale = 0.7;
         y_scale = 0.7;
         z_scale = 0.7;
-        glTranslated(-d*x_scale, -d*y_scale, -d*z_scale);
+        matrices.translate(-d*x_scale, -d*y_scale, -d*z_scale);
         
         switch(lag_dim)
         {
@@ -813,18 +867,13 @@ void attractor::draw_lagged_time_series(const int frame)
         }
         
         // draw attractor
-        glLineWidth(scale * LINE_WIDTH);
-        glPushMatrix();
-        glScaled(x_scale, y_scale, z_scale);
-        draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau);
-        glPopMatrix();
+        matrices.push();
+        matrices.scale(x_scale, y_scale, z_scale);
+        draw_embedding(ts->begin()+2*tau, ts->begin()+tau, ts->begin(), frame-2*tau, scale * LINE_WIDTH);
+        matrices.pop();
         
         // draw current point
-        glPointSize(POINT_WIDTH*scale);
-        glColor4dv(point_color);
-        glBegin(GL_POINTS);
-        glVertex3d(*(ts->begin() + frame-1)*x_scale, *(ts->begin() + frame-1-tau)*y_scale, *(ts->begin() + frame-1-2*tau)*z_scale);
-        glEnd();
+        enqueue_marker(*(ts->begin() + frame-1)*x_scale, *(ts->begin() + frame-1-tau)*y_scale, *(ts->begin() + frame-1-2*tau)*z_scale, point_color, POINT_WIDTH*scale);
         
         texture_scale *= 1.25;
         if(MANIFOLD_LABEL)
@@ -839,57 +888,57 @@ void attractor::draw_lagged_time_series(const int frame)
         texture_queue.clear();
      
         // draw half time series
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
+        matrices.mode(GL_PROJECTION);
+        matrices.load_identity();
+        matrices.ortho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
+        matrices.mode(GL_MODELVIEW);
+        matrices.load_identity();
         
         x_scale = 1.0;
         y_scale = 0.25;
         z_scale = 1.0;
         
-        glPushMatrix();
-        glTranslated(0.0, 0.4, 0.0);
+        matrices.push();
+        matrices.translate(0.0, 0.4, 0.0);
         draw_half_ts(frame, 0, 16*tau, lag_dim, 1, 0);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -0.3, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -0.3, 0.0);
         draw_half_ts(frame, 8*tau, 16*tau, lag_dim, LAG_SAT, 0.5);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -1.0, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -1.0, 0.0);
         draw_half_ts(frame, 16*tau, 16*tau, lag_dim, LAG2_SAT, 1);
-        glPopMatrix();
+        matrices.pop();
     }
     else
     {
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
+        matrices.mode(GL_PROJECTION);
+        matrices.load_identity();
+        matrices.ortho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
+        matrices.mode(GL_MODELVIEW);
+        matrices.load_identity();
         
         x_scale = 1.0;
         y_scale = 0.25;
         z_scale = 1.0;
         
-        glPushMatrix();
-        glTranslated(0.0, 0.4, 0.0);
+        matrices.push();
+        matrices.translate(0.0, 0.4, 0.0);
         draw_ts(frame, 0, 16*tau, lag_dim, 1, 0);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -0.3, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -0.3, 0.0);
         draw_ts(frame, 8*tau, 16*tau, lag_dim, LAG_SAT, 0.5);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -1.0, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -1.0, 0.0);
         draw_ts(frame, 16*tau, 16*tau, lag_dim, LAG2_SAT, 1);
-        glPopMatrix();
+        matrices.pop();
     }
     
 	return;
@@ -900,32 +949,27 @@ void attractor::draw_time_series(const int frame)
     if(SPLIT_VIEW)
     {
         // draw small attractor
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-        glMultMatrixd(rot_matrix);
-        glTranslated(1, init_distance, 0);    
+        matrices.mode(GL_PROJECTION);
+        matrices.load_identity();
+        matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+        matrices.mode(GL_MODELVIEW);
+        matrices.load_identity();
+        matrices.mult(rot_matrix);
+        matrices.translate(1, init_distance, 0);    
         
         x_scale = 0.7;
         y_scale = 0.7;
         z_scale = 0.7;
-        glTranslated(-d*x_scale, -d*y_scale, -d*z_scale);
+        matrices.translate(-d*x_scale, -d*y_scale, -d*z_scale);
         
         // draw attractor
-        glLineWidth(scale * LINE_WIDTH);
-        glPushMatrix();
-        glScaled(x_scale, y_scale, z_scale);
-        draw_embedding(x.begin(), y.begin(), z.begin(), frame);
-        glPopMatrix();
+        matrices.push();
+        matrices.scale(x_scale, y_scale, z_scale);
+        draw_embedding(x.begin(), y.begin(), z.begin(), frame, scale * LINE_WIDTH);
+        matrices.pop();
         
         // draw current point
-        glPointSize(POINT_WIDTH*scale);
-        glColor4dv(point_color);
-        glBegin(GL_POINTS);
-        glVertex3d(x[frame-1]*x_scale, y[frame-1]*y_scale, z[frame-1]*z_scale);
-        glEnd();
+        enqueue_marker(x[frame-1]*x_scale, y[frame-1]*y_scale, z[frame-1]*z_scale, point_color, POINT_WIDTH*scale);
         
         texture_scale *= 1.25;
         if(MANIFOLD_LABEL)
@@ -940,58 +984,58 @@ void attractor::draw_time_series(const int frame)
         texture_queue.clear();
         
         // draw half time series
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
+        matrices.mode(GL_PROJECTION);
+        matrices.load_identity();
+        matrices.ortho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
+        matrices.mode(GL_MODELVIEW);
+        matrices.load_identity();
         
         x_scale = 1.0;
         y_scale = 0.25;
         z_scale = 1.0;
         
-        glPushMatrix();
-        glTranslated(0.0, 0.4, 0.0);
+        matrices.push();
+        matrices.translate(0.0, 0.4, 0.0);
         draw_half_ts(frame, 0, 0, 1, 1, 0);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -0.3, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -0.3, 0.0);
         draw_half_ts(frame, 0, 0, 2, 1, 0);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -1.0, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -1.0, 0.0);
         draw_half_ts(frame, 0, 0, 3, 1, 0);
-        glPopMatrix();
+        matrices.pop();
         
     }
     else
     {
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
+        matrices.mode(GL_PROJECTION);
+        matrices.load_identity();
+        matrices.ortho(-1.2, 1.2, -1.2, 1.2, -1.5, 1.5);
+        matrices.mode(GL_MODELVIEW);
+        matrices.load_identity();
         
         x_scale = 1.0;
         y_scale = 0.25;
         z_scale = 1.0;
         
-        glPushMatrix();
-        glTranslated(0.0, 0.4, 0.0);
+        matrices.push();
+        matrices.translate(0.0, 0.4, 0.0);
         draw_ts(frame, 0, 0, 1, 1, 0);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -0.3, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -0.3, 0.0);
         draw_ts(frame, 0, 0, 2, 1, 0);
-        glPopMatrix();
+        matrices.pop();
         
-        glPushMatrix();
-        glTranslated(0.0, -1.0, 0.0);
+        matrices.push();
+        matrices.translate(0.0, -1.0, 0.0);
         draw_ts(frame, 0, 0, 3, 1, 0);
-        glPopMatrix();
+        matrices.pop();
     }
     
 	return;
@@ -999,35 +1043,30 @@ void attractor::draw_time_series(const int frame)
 
 void attractor::draw_manifold(const int frame)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glMultMatrixd(rot_matrix);
-    glTranslated(0, init_distance, 0);    
-    glRotated(phi_x[frame-1], 1, 0, 0);
-    glRotated(phi_y[frame-1], 0, 1, 0);
-    glRotated(phi_z[frame-1], 0, 0, 1);
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
+    matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
+    matrices.mult(rot_matrix);
+    matrices.translate(0, init_distance, 0);    
+    matrices.rotate(phi_x[frame-1], 1, 0, 0);
+    matrices.rotate(phi_y[frame-1], 0, 1, 0);
+    matrices.rotate(phi_z[frame-1], 0, 0, 1);
     
     x_scale = 1.0;
     y_scale = 1.0;
     z_scale = 1.0;
-	glTranslated(-d, -d, -d);
+	matrices.translate(-d, -d, -d);
     
 	// draw attractor
-    glLineWidth(scale * LINE_WIDTH);
-    draw_embedding(x.begin(), y.begin(), z.begin(), frame);
+    draw_embedding(x.begin(), y.begin(), z.begin(), frame, scale * LINE_WIDTH);
     
     if(MANIFOLD_LABEL)
         enqueue_label(d, d, 2*d, M_LABEL_TEXTURE, texture_scale, 1, 0);
 	
 	// draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(x[frame-1], y[frame-1], z[frame-1]);
-	glEnd();
+    enqueue_marker(x[frame-1], y[frame-1], z[frame-1], point_color, POINT_WIDTH*scale);
 	
 	draw_tracers(frame);
 	draw_axes(false, 0);
@@ -1148,43 +1187,33 @@ vector<double> attractor::draw_xmap_manifold(const int frame, const vector<int>
     point[1] = *(my_y + my_frame-1);
     point[2] = *(my_z + my_frame-1);
     
-    glPushMatrix();
-    glScaled(x_scale, y_scale, z_scale);
+    matrices.push();
+    matrices.scale(x_scale, y_scale, z_scale);
     
     // draw attractor
-    glLineWidth(scale * SMALL_LINE_WIDTH);
-    draw_embedding(my_x, my_y, my_z, my_frame);
+    draw_embedding(my_x, my_y, my_z, my_frame, scale * SMALL_LINE_WIDTH);
     
     // color nearest neighbors
-    glPointSize(7.0*scale);
-    glColor4dv(neighbor_color);
-    glBegin(GL_POINTS);
     total_weight = 0;
     for(int i = 0; i < nn_indices.size(); i++)
     {
-        glVertex3d(*(my_x + nn_indices[i]-delta_frame), *(my_y + nn_indices[i]-delta_frame), *(my_z + nn_indices[i]-delta_frame));
+        enqueue_marker(*(my_x + nn_indices[i]-delta_frame), *(my_y + nn_indices[i]-delta_frame), *(my_z + nn_indices[i]-delta_frame),
+                       neighbor_color, 7.0*scale);
         pred_x += *(my_x + nn_indices[i]-delta_frame) * nn_weights[i];
         pred_y += *(my_y + nn_indices[i]-delta_frame) * nn_weights[i];
         pred_z += *(my_z + nn_indices[i]-delta_frame) * nn_weights[i];
         total_weight += nn_weights[i];
     }
-    glEnd();
     
     // draw current point
-    glPointSize(POINT_WIDTH*scale);
-	glColor4dv(point_color);
-	glBegin(GL_POINTS);
-	glVertex3d(point[0], point[1], point[2]);
-	glEnd();
+    enqueue_marker(point[0], point[1], point[2], point_color, POINT_WIDTH*scale);
     
     // draw prediction
-    glPointSize(POINT_WIDTH*scale);
-	glColor4d(lag_dim == 1, lag_dim == 2, lag_dim == 3, 0.5);
-	glBegin(GL_POINTS);
-    glVertex4d(pred_x, pred_y, pred_z, total_weight);
-	glEnd();
+	if(total_weight > 0)
+		enqueue_marker(pred_x/total_weight, pred_y/total_weight, pred_z/total_weight,
+		               lag_dim == 1, lag_dim == 2, lag_dim == 3, 0.5, POINT_WIDTH*scale);
     
-    glPopMatrix();
+    matrices.pop();
     
     // draw axes
     switch(var)
@@ -1235,16 +1264,16 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
     switch(lag_dim)
 	{
 		case 1:
-            nn_indices = x_nn_indices[frame];
-            nn_weights = x_nn_weights[frame];
+            nn_indices = ccm.x_nn_indices[frame];
+            nn_weights = ccm.x_nn_weights[frame];
 			break;
 		case 2:
-            nn_indices = y_nn_indices[frame];
-            nn_weights = y_nn_weights[frame];
+            nn_indices = ccm.y_nn_indices[frame];
+            nn_weights = ccm.y_nn_weights[frame];
 			break;
 		case 3:
-            nn_indices = z_nn_indices[frame];
-            nn_weights = z_nn_weights[frame];
+            nn_indices = ccm.z_nn_indices[frame];
+            nn_weights = ccm.z_nn_weights[frame];
 			break;
 	}
     
@@ -1254,14 +1283,14 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
         x_scale = xmap_attractor_scale;
         y_scale = xmap_attractor_scale;
         z_scale = xmap_attractor_scale;
-        glPushMatrix();
-        glTranslated(-delta_x*x_scale, delta_y*y_scale-0.1, 0);
-        glRotated(theta, 0, 1, 0);
-        glTranslated(-d*x_scale, -d*y_scale, -d*z_scale);
+        matrices.push();
+        matrices.translate(-delta_x*x_scale, delta_y*y_scale-0.1, 0);
+        matrices.rotate(theta, 0, 1, 0);
+        matrices.translate(-d*x_scale, -d*y_scale, -d*z_scale);
         NW_point = draw_xmap_manifold(frame, nn_indices, nn_weights, NW_manifold, NW_manifold != 0);
         if(MANIFOLD_LABEL)
             enqueue_label(d*x_scale, 2*d*y_scale, 2*d*z_scale, M_LABEL_TEXTURE+NW_manifold, texture_scale, 1, 0);
-        glPopMatrix();
+        matrices.pop();
     }
     
     // ***** NE TIME SERIES *****
@@ -1270,10 +1299,10 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
         x_scale = 1.0;
         y_scale = xmap_attractor_scale;
         z_scale = xmap_attractor_scale;
-        glPushMatrix();
-        glTranslated(ts_delta_x, (delta_y-d)*y_scale-0.1, 0);
+        matrices.push();
+        matrices.translate(ts_delta_x, (delta_y-d)*y_scale-0.1, 0);
         draw_ts(frame, 0, 0, pred_dim, 1.0, 0);
-        glPopMatrix();
+        matrices.pop();
     }
     
     // ***** NE ATTRACTOR *****
@@ -1282,14 +1311,14 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
         x_scale = xmap_attractor_scale;
         y_scale = xmap_attractor_scale;
         z_scale = xmap_attractor_scale;
-        glPushMatrix();
-        glTranslated(delta_x*x_scale, delta_y*y_scale-0.1, 0);
-        glRotated(theta, 0, 1, 0);
-        glTranslated(-d*x_scale, -d*y_scale, -d*z_scale);
+        matrices.push();
+        matrices.translate(delta_x*x_scale, delta_y*y_scale-0.1, 0);
+        matrices.rotate(theta, 0, 1, 0);
+        matrices.translate(-d*x_scale, -d*y_scale, -d*z_scale);
         NE_point = draw_xmap_manifold(frame, nn_indices, nn_weights, NE_manifold, NE_manifold != 0);
         if(MANIFOLD_LABEL)
             enqueue_label(d*x_scale, 2*d*y_scale, 2*d*z_scale, M_LABEL_TEXTURE+NE_manifold, texture_scale, 1, 0);
-        glPopMatrix();
+        matrices.pop();
     }
     
     // ***** SW ATTRACTOR *****
@@ -1298,14 +1327,14 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
         x_scale = xmap_attractor_scale;
         y_scale = xmap_attractor_scale;
         z_scale = xmap_attractor_scale;
-        glPushMatrix();
-        glTranslated(-delta_x*x_scale, -delta_y*y_scale-0.1, 0);
-        glRotated(theta, 0, 1, 0);
-        glTranslated(-d*x_scale, -d*y_scale, -d*z_scale);
+        matrices.push();
+        matrices.translate(-delta_x*x_scale, -delta_y*y_scale-0.1, 0);
+        matrices.rotate(theta, 0, 1, 0);
+        matrices.translate(-d*x_scale, -d*y_scale, -d*z_scale);
         SW_point = draw_xmap_manifold(frame, nn_indices, nn_weights, SW_manifold, SW_manifold == 0);
         if(MANIFOLD_LABEL)
             enqueue_label(d*x_scale, 2*d*y_scale, 2*d*z_scale, M_LABEL_TEXTURE+SW_manifold, texture_scale, 1, 0);
-        glPopMatrix();
+        matrices.pop();
     }
     
 	// ***** SE TIME SERIES *****
@@ -1314,10 +1343,10 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
         x_scale = 1.0;
         y_scale = xmap_attractor_scale;
         z_scale = xmap_attractor_scale;
-        glPushMatrix();
-        glTranslated(ts_delta_x, (-delta_y-d)*y_scale-0.1, 0);
+        matrices.push();
+        matrices.translate(ts_delta_x, (-delta_y-d)*y_scale-0.1, 0);
         draw_ts(frame, tau, 2*tau, lag_dim, LAG_SAT, 0);
-        glPopMatrix();
+        matrices.pop();
     }
 	
     // ***** PROJECTION LINES *****
@@ -1326,21 +1355,21 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
         x_scale = xmap_attractor_scale;
         y_scale = xmap_attractor_scale;
         z_scale = xmap_attractor_scale;
-        glPushMatrix();
-        glScaled(x_scale, y_scale, z_scale);
-        glTranslated(-delta_x, delta_y-0.1/y_scale, 0);
-        glRotated(theta, 0, 1, 0);
-        glTranslated(-d, -d, -d);
+        matrices.push();
+        matrices.scale(x_scale, y_scale, z_scale);
+        matrices.translate(-delta_x, delta_y-0.1/y_scale, 0);
+        matrices.rotate(theta, 0, 1, 0);
+        matrices.translate(-d, -d, -d);
         
         // NW attractor to ts
         if(ts_trace)
         {
-            glColor3d(pred_dim == 1, pred_dim == 2, pred_dim == 3);
-            glLineWidth(scale * LINE_WIDTH);
-            glBegin(GL_LINES);
-            glVertex3d(NW_point[0], NW_point[1], NW_point[2]);
-            glVertex3d(project_dist*cos(theta/180*PI)+d, NW_point[1], project_dist*sin(theta/180*PI)+d);
-            glEnd();
+            render->color(pred_dim == 1, pred_dim == 2, pred_dim == 3);
+            render->line_width(scale * LINE_WIDTH);
+            render->begin(GL_LINES);
+            render->vertex(NW_point[0], NW_point[1], NW_point[2]);
+            render->vertex(project_dist*cos(theta/180*PI)+d, NW_point[1], project_dist*sin(theta/180*PI)+d);
+            render->end();
         }
         
         // NW attractor to NE attractor & SW attractor to NE attractor
@@ -1358,16 +1387,16 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
         // SW attractor to ts
         if(ts_trace)
         {
-            glTranslated(0, -2*delta_y, 0);
-            glColor3d(SW_manifold == 1, SW_manifold == 2, SW_manifold == 3);
-            glLineWidth(scale * LINE_WIDTH);
-            glBegin(GL_LINES);
-            glVertex3d(SW_point[0], SW_point[1], SW_point[2]);
-            glVertex3d(project_dist*cos(theta/180*PI)+d, SW_point[1], project_dist*sin(theta/180*PI)+d);
-            glEnd();
+            matrices.translate(0, -2*delta_y, 0);
+            render->color(SW_manifold == 1, SW_manifold == 2, SW_manifold == 3);
+            render->line_width(scale * LINE_WIDTH);
+            render->begin(GL_LINES);
+            render->vertex(SW_point[0], SW_point[1], SW_point[2]);
+            render->vertex(project_dist*cos(theta/180*PI)+d, SW_point[1], project_dist*sin(theta/180*PI)+d);
+            render->end();
         }
         
-        glPopMatrix();
+        matrices.pop();
     }
     
     return;
@@ -1375,6 +1404,7 @@ void attractor::draw_xmap_generic(const int frame, const int NW_manifold, const
 
 void attractor::draw_univariate_ts(int frame, vector<double>* ts)
 {
+    stats_timer timer(stats, DRAW_TIME_SERIES);
     int start_frame = 0;
 	int frame_skip = 1;
 	double project_t;
@@ -1389,34 +1419,32 @@ void attractor::draw_univariate_ts(int frame, vector<double>* ts)
 	if(start_frame < frame - num_points * draw_fraction / 2)
 		start_frame = frame - num_points * draw_fraction / 2;
     
-    glPushMatrix();
-    glScaled(x_scale, y_scale, z_scale);
+    matrices.push();
+    matrices.scale(x_scale, y_scale, z_scale);
     
-    glLineWidth(scale);
+    render->line_width(scale);
     // draw time series segment
-    glColor4dv(pred_color);
-	glBegin(GL_LINE_STRIP);
+    render->color(pred_color);
+	render->begin(GL_LINE_STRIP);
     for(ts_i = ts->begin() + start_frame; project_t < 0.0; ts_i+=frame_skip, project_t += project_scale)
 	{
         if(*ts_i != 0.0)
-            glVertex2d(project_t, *ts_i);
+            render->vertex(project_t, *ts_i);
 	}
-    glEnd();
+    render->end();
     
-    glBegin(GL_POINTS);
-    glVertex2d(project_t+tp*project_scale, *(ts_i+tp-1));
-    glEnd();
+    enqueue_marker(project_t+tp*project_scale, *(ts_i+tp-1), 0, pred_color, POINT_WIDTH*scale);
     
     // draw rest of time series segment
-    glBegin(GL_LINE_STRIP);
+    render->begin(GL_LINE_STRIP);
 	for(vector<double>::iterator ts_j = ts_i; (project_t < 1.0 && ts_j < ts->end()); ts_j+=frame_skip, project_t += project_scale)
 	{
-		glColor4d(project_t/8+0.75+pred_color[0], project_t/8+0.75+pred_color[1], project_t/8+0.75+pred_color[2], pred_color[3]);
-		glVertex2d(project_t, *ts_j);
+		render->color(project_t/8+0.75+pred_color[0], project_t/8+0.75+pred_color[1], project_t/8+0.75+pred_color[2], pred_color[3]);
+		render->vertex(project_t, *ts_j);
 	}
-	glEnd();
+	render->end();
     
-    glPopMatrix();
+    matrices.pop();
     
     return;
 }
@@ -1424,6 +1452,7 @@ void attractor::draw_univariate_ts(int frame, vector<double>* ts)
 void attractor::draw_xmap_ts(int frame, const int lag, const int skip, const int dim, 
                              const double sat, const double line_width, vector<double>* ts)
 {
+    stats_timer timer(stats, DRAW_TIME_SERIES);
     int start_frame = 0;
 	int frame_skip = 1;
 	int frame_skip_2 = 10;
@@ -1446,33 +1475,33 @@ void attractor::draw_xmap_ts(int frame, const int lag, const int skip, const int
 	if(start_frame < frame - lag - num_points * draw_fraction / 2)
 		start_frame = frame - lag - num_points * draw_fraction / 2;
     
-    glPushMatrix();
-    glScaled(x_scale, y_scale, z_scale);
+    matrices.push();
+    matrices.scale(x_scale, y_scale, z_scale);
     
-    glLineWidth(scale * line_width);
+    render->line_width(scale * line_width);
     // draw time series segment
-    glColor4d(r, g, b, 0.5);
-	glBegin(GL_LINE_STRIP);
+    render->color(r, g, b, 0.5);
+	render->begin(GL_LINE_STRIP);
     for(ts_i = ts->begin() + start_frame; project_t < 0.0; ts_i+=frame_skip, project_t += project_scale)
 	{
         if(*ts_i != 0.0)
-            glVertex2d(project_t, *ts_i);
+            render->vertex(project_t, *ts_i);
 	}
-    glEnd();
+    render->end();
     
     lagged_point_height = *(ts_i-1+lag);
     point_height = *(ts_i-1);
     
     // draw rest of time series segment
-    glBegin(GL_LINE_STRIP);
+    render->begin(GL_LINE_STRIP);
 	for(vector<double>::iterator ts_j = ts_i; (project_t < 1.0 && ts_j < ts->end()); ts_j+=frame_skip, project_t += project_scale)
 	{
-		glColor3d(project_t/8+0.75*sat+r, project_t/8+0.75*sat+g, project_t/8+0.75*sat+b);
-		glVertex2d(project_t, *ts_j);
+		render->color(project_t/8+0.75*sat+r, project_t/8+0.75*sat+g, project_t/8+0.75*sat+b);
+		render->vertex(project_t, *ts_j);
 	}
-	glEnd();
+	render->end();
     
-    glPopMatrix();
+    matrices.pop();
     
     return;
 }
@@ -1480,6 +1509,7 @@ void attractor::draw_xmap_ts(int frame, const int lag, const int skip, const int
 void attractor::draw_half_ts(int frame, const int lag, const int skip, const int dim, 
                         const double sat, const double line_width)
 {
+    stats_timer timer(stats, DRAW_TIME_SERIES);
 	int start_frame = 0;
 	int frame_skip = 2;
 	int frame_skip_2 = 10;
@@ -1492,6 +1522,8 @@ void attractor::draw_half_ts(int frame, const int lag, const int skip, const int
 	double y_max = 2*d;
 	double y_min = 0.0;
     int texture_index;
+    int past;
+    double time_scale, time_offset;
 	
 	switch(dim)
 	{
@@ -1533,35 +1565,51 @@ void attractor::draw_half_ts(int frame, const int lag, const int skip, const int
     // draw axis label
     enqueue_label(-1.02*x_scale, d*1.2*y_scale, 0, texture_index, texture_scale, 2, 0);
     
-    glPushMatrix();
-    glScaled(x_scale, y_scale, z_scale);    
+    matrices.push();
+    matrices.scale(x_scale, y_scale, z_scale);    
     
 	// draw axes
-    glLineWidth(scale);
-	glColor3d(LAG_SAT, LAG_SAT, LAG_SAT);
-	glBegin(GL_LINE_STRIP);
-	glVertex2d(-1.0, y_max);
-	glVertex2d(-1.0, y_min);
-	glVertex2d(0.0, y_min);
-	glEnd();
-    
-    // draw central line
-    glLineWidth(2.0*scale);
-    glColor4dv(point_color);
-	glBegin(GL_LINES);
-	glVertex2d(0.0, 2*d);
-	glVertex2d(0.0, 0.0);
-	glEnd();
-    
-    glLineWidth(scale * (LINE_WIDTH + line_width));
+    double key[STATIC_KEY_SIZE] = {2, scale};
+    if(!call_static_geometry(key))
+    {
+        render->line_width(scale);
+        render->color(LAG_SAT, LAG_SAT, LAG_SAT);
+        render->begin(GL_LINE_STRIP);
+        render->vertex(-1.0, y_max);
+        render->vertex(-1.0, y_min);
+        render->vertex(0.0, y_min);
+        render->end();
+        
+        // draw central line
+        render->line_width(2.0*scale);
+        render->color(point_color);
+        render->begin(GL_LINES);
+        render->vertex(0.0, 2*d);
+        render->vertex(0.0, 0.0);
+        render->end();
+        end_static_geometry(5);
+    }
+    
+    render->line_width(scale * (LINE_WIDTH + line_width));
     // draw time series segment
-	glColor3d(r, g, b);
-	glBegin(GL_LINE_STRIP);
-    for(ts_i = ts->begin() + start_frame; project_t < 0.0; ts_i+=frame_skip, project_t += project_scale)
-	{
-		glVertex2d(project_t, *ts_i);
-	}
-    glEnd();
+	render->color(r, g, b);
+    if(series_program != 0)
+    {
+        time_scale = project_scale / frame_skip;
+        time_offset = project_t - start_frame * time_scale;
+        past = project_t < 0.0 ? int(ceil(-project_t / project_scale)) : 0;
+        draw_series(dim, start_frame, past, frame_skip, time_scale, time_offset, false, sat);
+        ts_i = ts->begin() + start_frame + past*frame_skip;
+    }
+    else
+    {
+        render->begin(GL_LINE_STRIP);
+        for(ts_i = ts->begin() + start_frame; project_t < 0.0; ts_i+=frame_skip, project_t += project_scale)
+        {
+            render->vertex(project_t, *ts_i);
+        }
+        render->end();
+    }
     
     lagged_point_height = *(ts_i-1+lag);
     point_height = *(ts_i-1);
@@ -1569,14 +1617,10 @@ void attractor::draw_half_ts(int frame, const int lag, const int skip, const int
     // draw point
     if(lag == 0)
     {
-        glPointSize(POINT_WIDTH*scale);
-        glColor3d(r, g, b);
-        glBegin(GL_POINTS);
-        glVertex2d(0, point_height);
-        glEnd();
+        enqueue_marker(0, point_height, 0, r, g, b, 1.0, POINT_WIDTH*scale);
     }
     
-    glPopMatrix();
+    matrices.pop();
     
 	return;
 }
@@ -1584,6 +1628,7 @@ void attractor::draw_half_ts(int frame, const int lag, const int skip, const int
 void attractor::draw_ts(int frame, const int lag, const int skip, const int dim, 
                         const double sat, const double line_width)
 {
+    stats_timer timer(stats, DRAW_TIME_SERIES);
 	int start_frame = 0;
 	int frame_skip = 2;
 	int frame_skip_2 = 10;
@@ -1596,6 +1641,8 @@ void attractor::draw_ts(int frame, const int lag, const int skip, const int dim,
 	double y_max = 2*d;
 	double y_min = 0.0;
     int texture_index;
+    int past, future;
+    double time_scale, time_offset;
 	
 	switch(dim)
 	{
@@ -1637,104 +1684,137 @@ void attractor::draw_ts(int frame, const int lag, const int skip, const int dim,
     // draw axis label
     enqueue_label(-1.02*x_scale, d*1.2*y_scale, 0, texture_index, texture_scale, 2, 0);
     
-    glPushMatrix();
-    glScaled(x_scale, y_scale, z_scale);    
+    matrices.push();
+    matrices.scale(x_scale, y_scale, z_scale);    
     
 	// draw axes
-    glLineWidth(scale);
-	glColor3d(LAG_SAT, LAG_SAT, LAG_SAT);
-	glBegin(GL_LINE_STRIP);
-	glVertex2d(-1.0, y_max);
-	glVertex2d(-1.0, y_min);
-	glVertex2d(1.0, y_min);
-	glVertex2d(1.0, y_max);
-	glEnd();
-    
-    // draw central line
-    glLineWidth(2.0*scale);
-    glColor4dv(point_color);
-	glBegin(GL_LINES);
-	glVertex2d(0.0, 2*d);
-	glVertex2d(0.0, 0.0);
-	glEnd();
-    
-    glLineWidth(scale * (LINE_WIDTH + line_width));
+    double key[STATIC_KEY_SIZE] = {3, scale};
+    if(!call_static_geometry(key))
+    {
+        render->line_width(scale);
+        render->color(LAG_SAT, LAG_SAT, LAG_SAT);
+        render->begin(GL_LINE_STRIP);
+        render->vertex(-1.0, y_max);
+        render->vertex(-1.0, y_min);
+        render->vertex(1.0, y_min);
+        render->vertex(1.0, y_max);
+        render->end();
+        
+        // draw central line
+        render->line_width(2.0*scale);
+        render->color(point_color);
+        render->begin(GL_LINES);
+        render->vertex(0.0, 2*d);
+        render->vertex(0.0, 0.0);
+        render->end();
+        end_static_geometry(6);
+    }
+    
+    render->line_width(scale * (LINE_WIDTH + line_width));
     // draw time series segment
-	glColor3d(r, g, b);
-	glBegin(GL_LINE_STRIP);
-    for(ts_i = ts->begin() + start_frame; project_t < 0.0; ts_i+=frame_skip, project_t += project_scale)
-	{
-		glVertex2d(project_t, *ts_i);
-	}
-    glEnd();
+	render->color(r, g, b);
+    if(series_program != 0)
+    {
+        // the window only moves the draw ranges and the offset of the time axis
+        time_scale = project_scale / frame_skip;
+        time_offset = project_t - start_frame * time_scale;
+        past = project_t < 0.0 ? int(ceil(-project_t / project_scale)) : 0;
+        draw_series(dim, start_frame, past, frame_skip, time_scale, time_offset, false, sat);
+        ts_i = ts->begin() + start_frame + past*frame_skip;
+        project_t += past * project_scale;
+        
+        // draw rest of time series segment
+        future = min(int(ceil((1.0 - project_t) / project_scale)), int(ts->end() - ts_i + frame_skip-1) / frame_skip);
+        draw_series(dim, ts_i - ts->begin(), future, frame_skip, time_scale, time_offset, true, sat);
+    }
+    else
+    {
+        render->begin(GL_LINE_STRIP);
+        for(ts_i = ts->begin() + start_frame; project_t < 0.0; ts_i+=frame_skip, project_t += project_scale)
+        {
+            render->vertex(project_t, *ts_i);
+        }
+        render->end();
+        
+        // draw rest of time series segment
+        render->begin(GL_LINE_STRIP);
+        for(vector<double>::iterator ts_j = ts_i; (project_t < 1.0 && ts_j < ts->end()); ts_j+=frame_skip, project_t += project_scale)
+        {
+            render->color(project_t/8+0.75*sat+r, project_t/8+0.75*sat+g, project_t/8+0.75*sat+b);
+            render->vertex(project_t, *ts_j);
+        }
+        render->end();
+    }
     
     lagged_point_height = *(ts_i-1+lag);
     point_height = *(ts_i-1);
     
-    // draw rest of time series segment
-    glBegin(GL_LINE_STRIP);
-	for(vector<double>::iterator ts_j = ts_i; (project_t < 1.0 && ts_j < ts->end()); ts_j+=frame_skip, project_t += project_scale)
-	{
-		glColor3d(project_t/8+0.75*sat+r, project_t/8+0.75*sat+g, project_t/8+0.75*sat+b);
-		glVertex2d(project_t, *ts_j);
-	}
-	glEnd();
-    
     // draw point
     if(lag == 0)
     {
-        glPointSize(POINT_WIDTH*scale);
-        glColor3d(r, g, b);
-        glBegin(GL_POINTS);
-        glVertex2d(0, point_height);
-        glEnd();
+        enqueue_marker(0, point_height, 0, r, g, b, 1.0, POINT_WIDTH*scale);
     }
     
     if(DEBUG && skip != 0 && lag != 0 && VIEW != XMAP_TS)
     {
         if(lag != 16*tau || DEBUG > 1)
         {
-            glLineWidth(2.0*scale);
-            glColor3d(0.2, 0.2, 0.2);
-            glBegin(GL_LINE_STRIP);
-            glVertex2d(0, lagged_point_height);
-            glVertex2d(lag*project_scale/frame_skip, lagged_point_height);
-            glEnd();
-            glPointSize(POINT_WIDTH*scale);
-            glColor3d(r/sat, g/sat, b/sat);
-            glBegin(GL_POINTS);
-            glVertex2d(lag*project_scale/frame_skip, lagged_point_height);
-            glEnd();
+            render->line_width(2.0*scale);
+            render->color(0.2, 0.2, 0.2);
+            render->begin(GL_LINE_STRIP);
+            render->vertex(0, lagged_point_height);
+            render->vertex(lag*project_scale/frame_skip, lagged_point_height);
+            render->end();
+            enqueue_marker(lag*project_scale/frame_skip, lagged_point_height, 0, r/sat, g/sat, b/sat, 1.0, POINT_WIDTH*scale);
         }
 	}
     if(TSVIEW)
     {
         project_scale = 2.0 / num_points * frame_skip_2;
         project_t = -1.0;
-        glTranslated(0.0, -0.6, 0.0);
-        glScaled(1.0, 0.4, 1.0);
-        glLineWidth(scale);
-        glBegin(GL_LINE_STRIP);
-        glColor3d(LAG_SAT, LAG_SAT, LAG_SAT);
-        vector<double>::iterator ts_k1, ts_k2;
-        for(ts_k1 = ts->begin(); ts_k1 < ts->begin()+start_frame; ts_k1+=frame_skip_2, project_t += project_scale)
-        {
-            glVertex2d(project_t, *ts_k1);
-        }
-        glColor3d(r, g, b);
-        for(ts_k2 = ts_k1; ts_k2 < ts->begin()+frame; ts_k2+=frame_skip_2, project_t += project_scale)
+        matrices.translate(0.0, -0.6, 0.0);
+        matrices.scale(1.0, 0.4, 1.0);
+        render->line_width(scale);
+        if(series_program != 0)
         {
-            glVertex2d(project_t, *ts_k2);
+            // whole series in three strips, each starting at the last sample of the one before
+            int window_start = max(0, (start_frame + frame_skip_2-1) / frame_skip_2);
+            int window_end = max(window_start, (frame + frame_skip_2-1) / frame_skip_2);
+            int series_end = (num_points + frame_skip_2-1) / frame_skip_2;
+            time_scale = project_scale / frame_skip_2;
+            render->color(LAG_SAT, LAG_SAT, LAG_SAT);
+            draw_series(dim, 0, window_start, frame_skip_2, time_scale, -1.0, false, sat);
+            render->color(r, g, b);
+            draw_series(dim, max(0, window_start-1)*frame_skip_2, window_end - max(0, window_start-1), frame_skip_2,
+                        time_scale, -1.0, false, sat);
+            render->color(LAG_SAT, LAG_SAT, LAG_SAT);
+            draw_series(dim, max(0, window_end-1)*frame_skip_2, series_end - max(0, window_end-1), frame_skip_2,
+                        time_scale, -1.0, false, sat);
         }
-        glColor3d(LAG_SAT, LAG_SAT, LAG_SAT);
-        for(ts_k1 = ts_k2; ts_k1 < ts->end(); ts_k1+=frame_skip_2, project_t += project_scale)
+        else
         {
-            glVertex2d(project_t, *ts_k1);
+            render->begin(GL_LINE_STRIP);
+            render->color(LAG_SAT, LAG_SAT, LAG_SAT);
+            vector<double>::iterator ts_k1, ts_k2;
+            for(ts_k1 = ts->begin(); ts_k1 < ts->begin()+start_frame; ts_k1+=frame_skip_2, project_t += project_scale)
+            {
+                render->vertex(project_t, *ts_k1);
+            }
+            render->color(r, g, b);
+            for(ts_k2 = ts_k1; ts_k2 < ts->begin()+frame; ts_k2+=frame_skip_2, project_t += project_scale)
+            {
+                render->vertex(project_t, *ts_k2);
+            }
+            render->color(LAG_SAT, LAG_SAT, LAG_SAT);
+            for(ts_k1 = ts_k2; ts_k1 < ts->end(); ts_k1+=frame_skip_2, project_t += project_scale)
+            {
+                render->vertex(project_t, *ts_k1);
+            }
+            render->end();
         }
-        glEnd();
     }
     
-    glPopMatrix();
+    matrices.pop();
     
     if(DEBUG && skip != 0 && lag != 0)
     {
@@ -1751,34 +1831,487 @@ void attractor::draw_ts(int frame, const int lag, const int skip, const int dim,
 	return;
 }
 
-void attractor::draw_embedding(vector<double>::iterator x_i, vector<double>::iterator y_i, vector<double>::iterator z_i, const int frame)
+void attractor::draw_embedding(vector<double>::iterator x_i, vector<double>::iterator y_i, vector<double>::iterator z_i, const int frame,
+                               const double line_width)
 {
+    stats_timer timer(stats, DRAW_EMBEDDING);
+    render->line_width(line_width);
     // set current point
     curr_x = *(x_i + frame-1);
     curr_y = *(y_i + frame-1);
     curr_z = *(z_i + frame-1);
     
-    glBegin(GL_LINE_STRIP);
-	for(int i = 0; i < frame; i++, x_i++, y_i++, z_i++)
-	{
-		col(*x_i, *y_i, *z_i);
-		glVertex3d(*x_i, *y_i, *z_i);
-	}
-	glEnd();
+    if(!VERTEX_BUFFERS)
+    {
+        render->begin(GL_LINE_STRIP);
+        for(int i = 0; i < frame; i++, x_i++, y_i++, z_i++)
+        {
+            col(*x_i, *y_i, *z_i);
+            render->vertex(*x_i, *y_i, *z_i);
+        }
+        render->end();
+        stats.count_draw(frame);
+        return;
+    }
+    
+    // split each coordinate into its series and lag, the common lag is the first vertex
+    const double* coords[3] = {&*x_i, &*y_i, &*z_i};
+    const double* series[3];
+    int lag[3], first;
+    const trail_buffer* trail;
+    for(int k = 0; k < 3; k++)
+    {
+        if(coords[k] >= &x[0] && coords[k] < &x[0] + num_points)
+            series[k] = &x[0];
+        else if(coords[k] >= &y[0] && coords[k] < &y[0] + num_points)
+            series[k] = &y[0];
+        else
+            series[k] = &z[0];
+        lag[k] = coords[k] - series[k];
+    }
+    first = min(lag[0], min(lag[1], lag[2]));
+    for(int k = 0; k < 3; k++)
+        lag[k] -= first;
+    const embedding_buffer & b = find_embedding_buffer(series, lag);
+    
+    render->vertex_array(b.buffer, 3, 6*sizeof(GLfloat), (GLvoid*) 0);
+    if(embedding_program != 0)
+    {
+        render->use_program(embedding_program);
+        glUniform3f(current_point_location, curr_x, curr_y, curr_z);
+        glUniform1i(color_method_location, COLOR_METHOD);
+        trail = draw_embedding_trail(b, first, frame, line_width);
+        render->use_program(0);
+        render->disable_arrays();
+        if(trail != NULL)
+            composite_trail(*trail);
+        return;
+    }
+    
+    if(!COLOR_METHOD)
+    {
+        render->color_array(b.buffer, 3, 6*sizeof(GLfloat), (GLvoid*) (3*sizeof(GLfloat)));
+    }
+    else
+    {
+        // fade with the distance to the current point, which moves every frame
+        embedding_colors.resize(4*(first+frame));
+        for(int i = 0; i < frame; i++)
+        {
+            GLfloat* c = &embedding_colors[4*(first+i)];
+            c[0] = c[1] = c[2] = 0;
+            c[3] = exp(-8*d * dist_to_curr(*(x_i+i), *(y_i+i), *(z_i+i)));
+        }
+        render->color_array(0, 4, 0, &embedding_colors[0]);
+    }
+    trail = draw_embedding_trail(b, first, frame, line_width);
+    render->disable_arrays();
+    if(trail != NULL)
+        composite_trail(*trail);
     
     /*
-     glColor3d(1.0, 0.0, 1.0);
-     glPointSize(20);
-     glBegin(GL_POINTS);
-     glVertex3d(d, d, d);
-     glEnd();
+     render->color(1.0, 0.0, 1.0);
+     render->point_size(20);
+     render->begin(GL_POINTS);
+     render->vertex(d, d, d);
+     render->end();
      */
     
     return;
 }
 
+const embedding_buffer & attractor::find_embedding_buffer(const double* series[3], const int lag[3])
+{
+    const int max_buffers = 16;
+    embedding_buffer b;
+    vector<GLfloat> vertices;
+    
+    for(int i = 0; i < embedding_buffers.size(); i++)
+    {
+        const embedding_buffer & e = embedding_buffers[i];
+        if(equal(series, series+3, e.series) && equal(lag, lag+3, e.lag))
+            return e;
+    }
+    
+    // tau changes keep adding lags, drop the oldest embeddings
+    if(embedding_buffers.size() >= max_buffers)
+    {
+        glDeleteBuffers(1, &embedding_buffers[0].buffer);
+        glDeleteBuffers(1, &embedding_buffers[0].index_buffer);
+        embedding_buffers.erase(embedding_buffers.begin());
+    }
+    
+    // uploaded once, the data only changes in init()
+    for(int k = 0; k < 3; k++)
+    {
+        b.series[k] = series[k];
+        b.lag[k] = lag[k];
+    }
+    b.num_vertices = num_points - max(lag[0], max(lag[1], lag[2]));
+    vertices.resize(6*b.num_vertices);
+    for(int k = 0; k < 3; k++)
+    {
+        b.box_min[k] = series[k][lag[k]];
+        b.box_max[k] = series[k][lag[k]];
+    }
+    for(int i = 0; i < b.num_vertices; i++)
+    {
+        GLfloat* v = &vertices[6*i];
+        v[0] = series[0][i+lag[0]];
+        v[1] = series[1][i+lag[1]];
+        v[2] = series[2][i+lag[2]];
+        v[3] = v[4] = v[5] = series[0][i+lag[0]] - d + (1-d);
+        for(int k = 0; k < 3; k++)
+        {
+            b.box_min[k] = min(b.box_min[k], series[k][i+lag[k]]);
+            b.box_max[k] = max(b.box_max[k], series[k][i+lag[k]]);
+        }
+    }
+    glGenBuffers(1, &b.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, b.buffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    build_embedding_lod(b, vertices);
+    embedding_buffers.push_back(b);
+    return embedding_buffers.back();
+}
+
+void attractor::build_embedding_lod(embedding_buffer & b, const vector<GLfloat> & vertices)
+{
+    int num_blocks = (b.num_vertices-1) / LOD_BLOCK + 1;
+    vector<double> error(b.num_vertices, 0);
+    vector<int> stack;
+    vector<GLuint> indices;
+    
+    // top-down Douglas-Peucker within each block, a vertex is needed for any tolerance
+    // below its distance to the chord it splits; capping that by the parent's error
+    // makes the vertices kept at a coarser level a subset of those at a finer one
+    for(int block = 0; block < num_blocks; block++)
+    {
+        stack.push_back(block*LOD_BLOCK);
+        stack.push_back(min((block+1)*LOD_BLOCK, b.num_vertices-1));
+        stack.push_back(-1);
+        while(!stack.empty())
+        {
+            int split = stack.back(), hi = stack[stack.size()-2], lo = stack[stack.size()-3];
+            double cap = split < 0 ? HUGE_VAL : error[split], max_error = -1;
+            const GLfloat* p = &vertices[6*lo];
+            const GLfloat* q = &vertices[6*hi];
+            double pq[3] = {q[0]-p[0], q[1]-p[1], q[2]-p[2]};
+            double length = pq[0]*pq[0] + pq[1]*pq[1] + pq[2]*pq[2];
+            stack.resize(stack.size()-3);
+            split = -1;
+            for(int i = lo+1; i < hi; i++)
+            {
+                // distance to the segment pq
+                const GLfloat* v = &vertices[6*i];
+                double pv[3] = {v[0]-p[0], v[1]-p[1], v[2]-p[2]};
+                double u = length > 0 ? (pv[0]*pq[0] + pv[1]*pq[1] + pv[2]*pq[2]) / length : 0;
+                u = max(0.0, min(1.0, u));
+                double e = pow(pv[0]-u*pq[0], 2) + pow(pv[1]-u*pq[1], 2) + pow(pv[2]-u*pq[2], 2);
+                if(e > max_error)
+                {
+                    max_error = e;
+                    split = i;
+                }
+            }
+            if(split < 0)
+                continue;
+            error[split] = min(sqrt(max_error), cap);
+            stack.push_back(lo);
+            stack.push_back(split);
+            stack.push_back(split);
+            stack.push_back(split);
+            stack.push_back(hi);
+            stack.push_back(split);
+        }
+    }
+    
+    for(int l = 0; l < LOD_LEVELS; l++)
+    {
+        double tolerance = LOD_MIN_ERROR * (1 << l);
+        b.block_offset[l].resize(num_blocks+1);
+        for(int block = 0; block < num_blocks; block++)
+        {
+            int last = min((block+1)*LOD_BLOCK, b.num_vertices);
+            b.block_offset[l][block] = indices.size();
+            indices.push_back(block*LOD_BLOCK);
+            for(int i = block*LOD_BLOCK+1; i < last; i++)
+            {
+                if(error[i] >= tolerance)
+                    indices.push_back(i);
+            }
+        }
+        b.block_offset[l][num_blocks] = indices.size();
+    }
+    glGenBuffers(1, &b.index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return;
+}
+
+void attractor::draw_embedding_range(const embedding_buffer & b, const int first, const int count)
+{
+    double m[16], w, w_min = HUGE_VAL, pixels;
+    double row_x = 0, row_y = 0, row_w = 0;
+    int last = first + count - 1;
+    int start_block = (first + LOD_BLOCK-1) / LOD_BLOCK;
+    int end_block = last / LOD_BLOCK;
+    int level = -1;
+    
+    if(end_block <= start_block)
+    {
+        render->draw_arrays(GL_LINE_STRIP, first, count);
+        stats.count_draw(count);
+        return;
+    }
+    
+    // a displacement e in the embedding moves its projection by at most e * pixels,
+    // with pixels bounded over the bounding box of the embedding; the viewport is
+    // the whole window
+    multiply_matrix(matrices.top(GL_PROJECTION), matrices.top(GL_MODELVIEW), m);
+    for(int corner = 0; corner < 8; corner++)
+    {
+        w = m[15];
+        for(int k = 0; k < 3; k++)
+            w += m[3+4*k] * ((corner >> k) & 1 ? b.box_max[k] : b.box_min[k]);
+        w_min = min(w_min, w);
+    }
+    for(int k = 0; k < 3; k++)
+    {
+        row_x += m[4*k] * m[4*k];
+        row_y += m[1+4*k] * m[1+4*k];
+        row_w += m[3+4*k] * m[3+4*k];
+    }
+    if(w_min > 0)
+    {
+        pixels = max(window_width * (sqrt(row_x) + sqrt(row_w)), window_height * (sqrt(row_y) + sqrt(row_w))) / (2*w_min);
+        while(level+1 < LOD_LEVELS && LOD_MIN_ERROR * (1 << (level+1)) * pixels <= LOD_PIXEL_ERROR)
+            level++;
+    }
+    if(level < 0)
+    {
+        render->draw_arrays(GL_LINE_STRIP, first, count);
+        stats.count_draw(count);
+        return;
+    }
+    
+    // partial blocks at both ends in full, the whole blocks between them simplified
+    const vector<int> & offset = b.block_offset[level];
+    render->draw_arrays(GL_LINE_STRIP, first, start_block*LOD_BLOCK - first + 1);
+    render->draw_elements(GL_LINE_STRIP, b.index_buffer, offset[start_block], offset[end_block] - offset[start_block] + 1,
+                          end_block*LOD_BLOCK);
+    render->draw_arrays(GL_LINE_STRIP, end_block*LOD_BLOCK, last - end_block*LOD_BLOCK + 1);
+    stats.count_draw(start_block*LOD_BLOCK - first + 1);
+    stats.count_draw(offset[end_block] - offset[start_block] + 1);
+    stats.count_draw(last - end_block*LOD_BLOCK + 1);
+    return;
+}
+
+void attractor::build_series_buffers()
+{
+    vector<double>* series[3] = {&x, &y, &z};
+    vector<GLfloat> vertices(2*num_points);
+    
+    glGenBuffers(3, series_buffers);
+    for(int k = 0; k < 3; k++)
+    {
+        for(int i = 0; i < num_points; i++)
+        {
+            vertices[2*i] = i;
+            vertices[2*i+1] = (*series[k])[i];
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, series_buffers[k]);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return;
+}
+
+void attractor::draw_series(const int dim, const int first, const int count, const int stride, const double time_scale,
+                            const double time_offset, const bool fade, const double sat)
+{
+    if(count < 1)
+        return;
+    
+    // samples first, first+stride, ..., first+(count-1)*stride in the current color
+    render->vertex_array(series_buffers[dim-1], 2, stride*2*sizeof(GLfloat), (GLvoid*) ((first % stride)*2*sizeof(GLfloat)));
+    render->use_program(series_program);
+    glUniform2f(time_transform_location, time_scale, time_offset);
+    glUniform1i(fade_location, fade);
+    glUniform1f(sat_location, sat);
+    render->draw_arrays(GL_LINE_STRIP, first / stride, count);
+    stats.count_draw(count);
+    render->use_program(0);
+    render->disable_arrays();
+    return;
+}
+
+const trail_buffer* attractor::draw_embedding_trail(const embedding_buffer & b, const int first, const int count,
+                                                    const double line_width)
+{
+    double m[16], w, p, lo[2] = {HUGE_VAL, HUGE_VAL}, hi[2] = {-HUGE_VAL, -HUGE_VAL};
+    int size[2] = {window_width, window_height};
+    GLint target;
+    GLfloat clear_color[4];
+    int t;
+    
+    // distance coloring changes every vertex every frame
+    if(!TRAIL_BUFFERS || COLOR_METHOD || count < 2)
+    {
+        draw_embedding_range(b, first, count);
+        return NULL;
+    }
+    
+    multiply_matrix(matrices.top(GL_PROJECTION), matrices.top(GL_MODELVIEW), m);
+    for(t = trails.size()-1; t >= 0; t--)
+    {
+        if(trails[t].buffer == b.buffer && trails[t].first == first && trails[t].line_width == line_width &&
+           equal(m, m+16, trails[t].matrix))
+            break;
+    }
+    if(t < 0)
+    {
+        // the camera moved, draw directly until it stays still for a frame
+        trail_buffer trail;
+        trail.framebuffer = 0;
+        trail.texture = 0;
+        if(trails.size() == MAX_TRAILS)
+        {
+            trail = trails[0];
+            trails.erase(trails.begin());
+        }
+        trail.buffer = b.buffer;
+        trail.first = first;
+        trail.line_width = line_width;
+        copy(m, m+16, trail.matrix);
+        trail.frame = 0;
+        
+        // only the pixels the bounding box projects to are cleared and composited
+        for(int corner = 0; corner < 8 && lo[0] > -HUGE_VAL; corner++)
+        {
+            w = m[15];
+            for(int k = 0; k < 3; k++)
+                w += m[3+4*k] * ((corner >> k) & 1 ? b.box_max[k] : b.box_min[k]);
+            for(int j = 0; j < 2; j++)
+            {
+                p = m[12+j];
+                for(int k = 0; k < 3; k++)
+                    p += m[j+4*k] * ((corner >> k) & 1 ? b.box_max[k] : b.box_min[k]);
+                if(w <= 0)
+                {
+                    lo[0] = lo[1] = -HUGE_VAL;
+                    hi[0] = hi[1] = HUGE_VAL;
+                    break;
+                }
+                lo[j] = min(lo[j], p/w);
+                hi[j] = max(hi[j], p/w);
+            }
+        }
+        for(int j = 0; j < 2; j++)
+        {
+            // pad by the line width for the smoothed edges
+            lo[j] = floor((max(lo[j], -1.0) + 1) * size[j]/2 - line_width - 1);
+            hi[j] = ceil((min(hi[j], 1.0) + 1) * size[j]/2 + line_width + 1);
+            trail.rect[j] = max(0, int(lo[j]));
+            trail.rect[2+j] = max(0, min(size[j], int(hi[j])) - trail.rect[j]);
+        }
+        trails.push_back(trail);
+        draw_embedding_range(b, first, count);
+        return NULL;
+    }
+    trails.push_back(trails[t]);
+    trails.erase(trails.begin() + t);
+    trail_buffer & trail = trails.back();
+    
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target);
+    if(trail.framebuffer == 0)
+    {
+        glGenTextures(1, &trail.texture);
+        glBindTexture(GL_TEXTURE_2D, trail.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, window_width, window_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenFramebuffers(1, &trail.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, trail.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, trail.texture, 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, trail.framebuffer);
+    
+    // accumulate premultiplied, so the trail composites over the scene like the lines would
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    if(trail.frame == 0 || trail.frame > count)
+    {
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(trail.rect[0], trail.rect[1], trail.rect[2], trail.rect[3]);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+        draw_embedding_range(b, first, count);
+    }
+    else if(trail.frame < count)
+    {
+        // only the segments since the last frame, starting at its last vertex
+        render->draw_arrays(GL_LINE_STRIP, first + trail.frame - 1, count - trail.frame + 1);
+        stats.count_draw(count - trail.frame + 1);
+    }
+    trail.frame = count;
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return &trail;
+}
+
+void attractor::composite_trail(const trail_buffer & trail)
+{
+    // one texel per pixel over the trail's rectangle
+    double x0 = double(trail.rect[0]) / window_width, x1 = double(trail.rect[0] + trail.rect[2]) / window_width;
+    double y0 = double(trail.rect[1]) / window_height, y1 = double(trail.rect[1] + trail.rect[3]) / window_height;
+    
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    matrices.mode(GL_PROJECTION);
+    matrices.push();
+    matrices.load_identity();
+    matrices.mode(GL_MODELVIEW);
+    matrices.push();
+    matrices.load_identity();
+    render->texture(trail.texture);
+    render->color(1.0, 1.0, 1.0, 1.0);
+    render->begin(GL_QUADS);
+    render->tex_coord(x0, y0); render->vertex(2*x0-1, 2*y0-1);
+    render->tex_coord(x1, y0); render->vertex(2*x1-1, 2*y0-1);
+    render->tex_coord(x1, y1); render->vertex(2*x1-1, 2*y1-1);
+    render->tex_coord(x0, y1); render->vertex(2*x0-1, 2*y1-1);
+    render->end();
+    render->texture(0);
+    stats.count_draw(4);
+    stats.count_texture_bind();
+    matrices.pop();
+    matrices.mode(GL_PROJECTION);
+    matrices.pop();
+    matrices.mode(GL_MODELVIEW);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return;
+}
+
+void attractor::clear_trails()
+{
+    for(int t = 0; t < trails.size(); t++)
+    {
+        if(trails[t].framebuffer == 0)
+            continue;
+        glDeleteFramebuffers(1, &trails[t].framebuffer);
+        glDeleteTextures(1, &trails[t].texture);
+    }
+    trails.clear();
+    return;
+}
+
 void attractor::draw_tracers(const int frame)
 {	
+    stats_timer timer(stats, DRAW_TRACERS);
 	int frame_skip = 2;
 	double project_t;
 	double project_scale = 0.0014*frame_skip;
@@ -1788,25 +2321,22 @@ void attractor::draw_tracers(const int frame)
 		case NONE:
 			break;
 		case TRACE:
-			glColor3d(1.0, 0.0, 0.0);
+			render->color(1.0, 0.0, 0.0);
 			project_t = -project_scale/frame_skip * (frame-x_start_time-1);
-			glBegin(GL_LINE_STRIP);
+			render->begin(GL_LINE_STRIP);
 			for(int i = x_start_time; i < frame; i+=frame_skip, project_t += project_scale)
 			{
-				glVertex3d(x[i], project_t, 0);
+				render->vertex(x[i], project_t, 0);
 			}
-			glEnd();
-            glPointSize(POINT_WIDTH*scale);
-			glBegin(GL_POINTS);
-			glVertex3d(x[frame-1], 0, 0);
-			glEnd();
+			render->end();
+			enqueue_marker(x[frame-1], 0, 0, 1.0, 0.0, 0.0, 1.0, POINT_WIDTH*scale);
 		case PROJECT:
-			glColor3d(1.0, 0.0, 0.0);
-			glBegin(GL_LINE_STRIP);
-			glVertex3d(x[frame-1], y[frame-1], z[frame-1]);
-			glVertex3d(x[frame-1], y[frame-1], 0);
-			glVertex3d(x[frame-1], 0, 0);
-			glEnd();
+			render->color(1.0, 0.0, 0.0);
+			render->begin(GL_LINE_STRIP);
+			render->vertex(x[frame-1], y[frame-1], z[frame-1]);
+			render->vertex(x[frame-1], y[frame-1], 0);
+			render->vertex(x[frame-1], 0, 0);
+			render->end();
 			break;
 	}
 	switch(y_tracer)
@@ -1814,25 +2344,22 @@ void attractor::draw_tracers(const int frame)
 		case NONE:
 			break;
 		case TRACE:
-			glColor3d(0.0, 1.0, 0.0);
+			render->color(0.0, 1.0, 0.0);
 			project_t = -project_scale/frame_skip * (frame-y_start_time-1);
-			glBegin(GL_LINE_STRIP);
+			render->begin(GL_LINE_STRIP);
 			for(int i = y_start_time; i < frame; i+=frame_skip, project_t += project_scale)
 			{
-				glVertex3d(project_t, y[i], 0);
+				render->vertex(project_t, y[i], 0);
 			}
-			glEnd();
-            glPointSize(POINT_WIDTH*scale);
-			glBegin(GL_POINTS);
-			glVertex3d(0, y[frame-1], 0);
-			glEnd();
+			render->end();
+			enqueue_marker(0, y[frame-1], 0, 0.0, 1.0, 0.0, 1.0, POINT_WIDTH*scale);
 		case PROJECT:
-			glColor3d(0.0, 1.0, 0.0);
-			glBegin(GL_LINE_STRIP);
-			glVertex3d(x[frame-1], y[frame-1], z[frame-1]);
-			glVertex3d(0, y[frame-1], z[frame-1]);
-			glVertex3d(0, y[frame-1], 0);
-			glEnd();
+			render->color(0.0, 1.0, 0.0);
+			render->begin(GL_LINE_STRIP);
+			render->vertex(x[frame-1], y[frame-1], z[frame-1]);
+			render->vertex(0, y[frame-1], z[frame-1]);
+			render->vertex(0, y[frame-1], 0);
+			render->end();
 			break;
 	}
 	switch(z_tracer)
@@ -1840,25 +2367,22 @@ void attractor::draw_tracers(const int frame)
 		case NONE:
 			break;
 		case TRACE:
-			glColor3d(0.0, 0.0, 1.0);
+			render->color(0.0, 0.0, 1.0);
 			project_t = -project_scale/frame_skip * (frame-z_start_time-1);
-			glBegin(GL_LINE_STRIP);
+			render->begin(GL_LINE_STRIP);
 			for(int i = z_start_time; i < frame; i+=frame_skip, project_t += project_scale)
 			{
-				glVertex3d(project_t, 0, z[i]);
+				render->vertex(project_t, 0, z[i]);
 			}
-			glEnd();
-            glPointSize(POINT_WIDTH*scale);
-			glBegin(GL_POINTS);
-			glVertex3d(0, 0, z[frame-1]);
-			glEnd();
+			render->end();
+			enqueue_marker(0, 0, z[frame-1], 0.0, 0.0, 1.0, 1.0, POINT_WIDTH*scale);
 		case PROJECT:
-			glColor3d(0.0, 0.0, 1.0);
-			glBegin(GL_LINE_STRIP);
-			glVertex3d(x[frame-1], y[frame-1], z[frame-1]);
-			glVertex3d(x[frame-1], 0, z[frame-1]);
-			glVertex3d(0, 0, z[frame-1]);
-			glEnd();
+			render->color(0.0, 0.0, 1.0);
+			render->begin(GL_LINE_STRIP);
+			render->vertex(x[frame-1], y[frame-1], z[frame-1]);
+			render->vertex(x[frame-1], 0, z[frame-1]);
+			render->vertex(0, 0, z[frame-1]);
+			render->end();
 			break;
 	}	
 	
@@ -1936,10 +2460,12 @@ void attractor::draw_lag_axis(int direction, int dim, int lag)
 void attractor::draw_axis(const int axis, const double r, const double g, const double b, 
                           const double delta_line_width, const int texture_index, const int lag)
 {
+    stats_timer timer(stats, DRAW_AXES);
     double x_len = 0, y_len = 0, z_len = 0;
     double k_x = d/30, k_y = d/30, k_z = d/30;
     double axis_scale = 59.0/60.0;
     double label_scale = 1.12;
+    const int slices = 12;
     
     switch(axis)
     {
@@ -1964,138 +2490,353 @@ void attractor::draw_axis(const int axis, const double r, const double g, const
     // label
     enqueue_label(x_scale*(x_len*label_scale), y_scale*(y_len*label_scale), z_scale*(z_len*label_scale), texture_index, texture_scale, 1-(axis==2), 1+(axis==2));
     
-    glPushMatrix();
-    glScaled(x_scale, y_scale, z_scale);
+    double key[STATIC_KEY_SIZE] = {1, double(axis), r, g, b, delta_line_width, double(VIEW), double(DRAW_CONE)};
+    
+    matrices.push();
+    matrices.scale(x_scale, y_scale, z_scale);
+    if(call_static_geometry(key))
+    {
+        matrices.pop();
+        return;
+    }
     
-	glLineWidth(scale*(LINE_WIDTH+delta_line_width));
-    glColor3d(r, g, b);
+	render->line_width(scale*(LINE_WIDTH+delta_line_width));
+    render->color(r, g, b);
     
     // draw axis line
-	glBegin(GL_LINES);
-	glVertex3d(0, 0, 0);
-	glVertex3d(x_len, y_len, z_len);
-	glEnd();
+	render->begin(GL_LINES);
+	render->vertex(0, 0, 0);
+	render->vertex(x_len, y_len, z_len);
+	render->end();
     
     // draw axis end
     if(DRAW_CONE)
     {
-        glPushMatrix();
-        glTranslated(x_len, y_len, z_len);
-        glRotated(90, -y_len, x_len, z_len);
-        glutSolidCone(0.018, 0.090, 12, 2);
-        glPopMatrix();
+        // placed on the CPU, the stack only loads absolute matrices and a list
+        // replays no matrix changes in a core profile context
+        double m[16];
+        quaternion::from_axis_angle(90, -y_len, x_len, z_len).to_matrix(m);
+        m[12] = x_len;
+        m[13] = y_len;
+        m[14] = z_len;
+        draw_cone(0.018, 0.090, slices, m);
     }
     else
     {
-        glBegin(GL_LINES);
-        glVertex3d(x_len, y_len, z_len);
-        glVertex3d(x_len*axis_scale+k_x, y_len*axis_scale, z_len*axis_scale);
-        glVertex3d(x_len, y_len, z_len);
-        glVertex3d(x_len*axis_scale-k_x, y_len*axis_scale, z_len*axis_scale);
-        glVertex3d(x_len, y_len, z_len);
-        glVertex3d(x_len*axis_scale, y_len*axis_scale+k_y, z_len*axis_scale);
-        glVertex3d(x_len, y_len, z_len);
-        glVertex3d(x_len*axis_scale, y_len*axis_scale-k_y, z_len*axis_scale);
-        glVertex3d(x_len, y_len, z_len);
-        glVertex3d(x_len*axis_scale, y_len*axis_scale, z_len*axis_scale+k_z);
-        glVertex3d(x_len, y_len, z_len);
-        glVertex3d(x_len*axis_scale, y_len*axis_scale, z_len*axis_scale-k_z);
-        glVertex3d(x_len, y_len, z_len);
-        glEnd();
-    }
-    glPopMatrix();
+        render->begin(GL_LINES);
+        render->vertex(x_len, y_len, z_len);
+        render->vertex(x_len*axis_scale+k_x, y_len*axis_scale, z_len*axis_scale);
+        render->vertex(x_len, y_len, z_len);
+        render->vertex(x_len*axis_scale-k_x, y_len*axis_scale, z_len*axis_scale);
+        render->vertex(x_len, y_len, z_len);
+        render->vertex(x_len*axis_scale, y_len*axis_scale+k_y, z_len*axis_scale);
+        render->vertex(x_len, y_len, z_len);
+        render->vertex(x_len*axis_scale, y_len*axis_scale-k_y, z_len*axis_scale);
+        render->vertex(x_len, y_len, z_len);
+        render->vertex(x_len*axis_scale, y_len*axis_scale, z_len*axis_scale+k_z);
+        render->vertex(x_len, y_len, z_len);
+        render->vertex(x_len*axis_scale, y_len*axis_scale, z_len*axis_scale-k_z);
+        render->vertex(x_len, y_len, z_len);
+        render->end();
+    }
+    end_static_geometry(DRAW_CONE ? 2*slices+6 : 15);
+    matrices.pop();
     
     return;
 }
 
-void attractor::draw_labels()
+void attractor::draw_cone(const double base, const double height, const int slices, const double* m)
 {
-    texture_2d curr_texture;
-    double x_pos;
-    double y_pos;
+    vector<double> tip(3), rim(3*(slices+1));
     
-    // sort textures by depth
-    sort(texture_queue.begin(), texture_queue.end());
+    // same shape as glutSolidCone, which needs GLUT initialized with a display
+    for(int k = 0; k < 3; k++)
+    {
+        tip[k] = m[8+k]*height + m[12+k];
+        for(int i = 0; i <= slices; i++)
+            rim[3*i+k] = m[k]*base*cos(2*M_PI*i/slices) + m[4+k]*base*sin(2*M_PI*i/slices) + m[12+k];
+    }
+    render->begin(GL_TRIANGLE_FAN);
+    render->vertex(tip[0], tip[1], tip[2]);
+    for(int i = 0; i <= slices; i++)
+        render->vertex(rim[3*i], rim[3*i+1], rim[3*i+2]);
+    render->end();
+    render->begin(GL_TRIANGLE_FAN);
+    render->vertex(m[12], m[13], m[14]);
+    for(int i = slices; i >= 0; i--)
+        render->vertex(rim[3*i], rim[3*i+1], rim[3*i+2]);
+    render->end();
+    return;
+}
+
+bool attractor::call_static_geometry(const double* key)
+{
+    static_geometry g;
     
-    // draw textures
-    for(vector<texture_label>::iterator iter = texture_queue.begin(); iter != texture_queue.end(); iter++)
+    for(int i = 0; i < static_geometry_cache.size(); i++)
     {
-        glPushMatrix();
-        
-        // reset projection matrix
-        glLoadIdentity();
-        
-        switch(VIEW)
+        if(equal(key, key+STATIC_KEY_SIZE, static_geometry_cache[i].key))
         {
-            case MANIFOLD:
-            case RECONSTRUCTION:
-            case GENERIC_RECONSTRUCTION:
-            case SHADOW:
-            case UNIVARIATE:
-            case UNIVARIATE_TS:
-            case XMAP:
-            case XMAP_TS:
-                glMultMatrixd(iter->billboard_matrix);
-                break;
-            case TIME_SERIES:
-            case LAGS:
-                glMultMatrixd(iter->billboard_matrix);
-                if(window_width > window_height)
-                {
-                    glScaled(double(window_height)/double(window_width), 1.0, 1.0);
-                }
-                else
-                {
-                    glScaled(1.0, double(window_width)/double(window_height), 1.0);
-                }
-                
-                break;
-            default:
-                glPopMatrix();
-                return;
+            render->call_list(static_geometry_cache[i].list);
+            stats.count_draw(static_geometry_cache[i].num_vertices);
+            return true;
         }
-        
-        // load texture
-        curr_texture = my_textures[iter->index];
-        glBindTexture(GL_TEXTURE_2D, curr_texture.texture_id);
-        
-        // draw
-        x_pos = curr_texture.width/2.0*(1-iter->x_peg);
-        y_pos = curr_texture.height/2.0*(iter->y_peg-1);
-        glColor3d(1.0, 1.0, 1.0);
-        glScaled(iter->scale, iter->scale, 1.0);
-        glEnable(GL_TEXTURE_2D);
-        glBegin(GL_QUADS);
-        glNormal3f(0.0, 0.0, -1.0);
-        glTexCoord2d(0.0, 0.0); glVertex3d(-curr_texture.width/2.0+x_pos, -curr_texture.height/2.0+y_pos, 0.0);
-        glTexCoord2d(0.0, 1.0); glVertex3d(-curr_texture.width/2.0+x_pos, curr_texture.height/2.0+y_pos, 0.0);
-        glTexCoord2d(1.0, 1.0); glVertex3d(curr_texture.width/2.0+x_pos, curr_texture.height/2.0+y_pos, 0.0);
-        glTexCoord2d(1.0, 0.0); glVertex3d(curr_texture.width/2.0+x_pos, -curr_texture.height/2.0+y_pos, 0.0);
-        glEnd();
-        glDisable(GL_TEXTURE_2D);
-        
-        glPopMatrix();
-        
     }
+    
+    // not cached yet, record it while drawing it; no matrix stack calls until
+    // end_static_geometry, they load absolute matrices
+    copy(key, key+STATIC_KEY_SIZE, g.key);
+    g.list = render->begin_list();
+    static_geometry_cache.push_back(g);
+    return false;
+}
+
+void attractor::end_static_geometry(const int num_vertices)
+{
+    render->end_list();
+    static_geometry_cache.back().num_vertices = num_vertices;
+    stats.count_draw(num_vertices);
     return;
 }
 
-void attractor::enqueue_label(double pos_x, double pos_y, double pos_z, int texture_index, double scale, int x_peg, int y_peg)
+void attractor::clear_static_geometry()
 {
-    
-    // get camera position and vectors
-    double modelview_matrix[16], billboard_matrix[16], curr_matrix[16];
-    double camera_pos[3], new_camera_pos[3], pos[3];
-    double camera_up[3], look[3];
-    double bb_up[3], bb_right[3];
-    double temp;
-    
-    // save in curr_label
-    texture_label curr_label;
-    
-    glGetDoublev(GL_MODELVIEW_MATRIX, modelview_matrix);
-    glGetDoublev(GL_MODELVIEW_MATRIX, curr_matrix);
-    
+    for(int i = 0; i < static_geometry_cache.size(); i++)
+        render->delete_list(static_geometry_cache[i].list);
+    static_geometry_cache.clear();
+    return;
+}
+
+void attractor::update_skill(const int frame)
+{
+    vector<double>* truth[3] = {&x, &y, &z};
+    vector<double>* forecast[3] = {&ccm.x_forecast, &ccm.y_forecast, &ccm.z_forecast};
+    vector<double>* xmap[3][3] = {{NULL, &ccm.x_xmap_y, &ccm.x_xmap_z},
+                                  {&ccm.y_xmap_x, NULL, &ccm.y_xmap_z},
+                                  {&ccm.z_xmap_x, &ccm.z_xmap_y, NULL}};
+    int xmap_first = 2*ccm.tau + ccm.nn_skip*ccm.nn_num; // first frame with neighbors
+    int forecast_first = xmap_first + ccm.tp;
+    
+    // restarted animation
+    if(frame < skill_frame)
+        reset_skill();
+    
+    // only the frames passed since the last redraw
+    for(; skill_frame < frame && skill_frame < num_points; skill_frame++)
+    {
+        for(int m = 0; m < 3; m++)
+        {
+            if(skill_frame >= forecast_first)
+                forecast_skill[m].add((*forecast[m])[skill_frame], (*truth[m])[skill_frame]);
+            if(skill_frame < xmap_first)
+                continue;
+            for(int v = 0; v < 3; v++)
+            {
+                if(v != m)
+                    xmap_skill[m][v].add((*xmap[m][v])[skill_frame], (*truth[v])[skill_frame]);
+            }
+        }
+    }
+    return;
+}
+
+void attractor::reset_skill()
+{
+    for(int m = 0; m < 3; m++)
+    {
+        forecast_skill[m].reset();
+        for(int v = 0; v < 3; v++)
+            xmap_skill[m][v].reset();
+    }
+    skill_frame = 0;
+    return;
+}
+
+void attractor::draw_skill_hud()
+{
+    stats_timer timer(stats, DRAW_HUD);
+    const char names[3] = {'x', 'y', 'z'};
+    const running_skill* skill_stats;
+    char text[128];
+    double left;
+    
+    if(VIEW == UNIVARIATE || VIEW == UNIVARIATE_TS)
+    {
+        skill_stats = &forecast_skill[lag_dim-1];
+        snprintf(text, sizeof(text), "forecast %c (tp = %d):  rho = %.3f  MAE = %.3f  RMSE = %.3f  (n = %d)",
+                 names[lag_dim-1], ccm.tp, skill_stats->rho(), skill_stats->mae(), skill_stats->rmse(), skill_stats->count());
+    }
+    else
+    {
+        skill_stats = &xmap_skill[lag_dim-1][pred_dim-1];
+        snprintf(text, sizeof(text), "M_%c xmap %c:  rho = %.3f  MAE = %.3f  RMSE = %.3f  (n = %d)",
+                 names[lag_dim-1], names[pred_dim-1], skill_stats->rho(), skill_stats->mae(), skill_stats->rmse(), skill_stats->count());
+    }
+    
+    // bottom left corner of the ortho view set up in draw()
+    if(0.75*window_width > window_height)
+        left = -1.5*window_width/window_height;
+    else
+        left = -2.0;
+    
+    render->color(0.0, 0.0, 0.0);
+    render->text(left + 0.05, -1.45, text);
+    return;
+}
+
+void attractor::draw_frame_stats_hud()
+{
+    stats_timer timer(stats, DRAW_HUD);
+    char text[128];
+    double left, top;
+    int line = 0;
+    
+    // top left corner of the ortho view set up in draw()
+    if(0.75*window_width > window_height)
+    {
+        left = -1.5*window_width/window_height;
+        top = 1.5;
+    }
+    else
+    {
+        left = -2.0;
+        top = 2.0*window_height/window_width;
+    }
+    
+    // the previous frame, this one is still being drawn
+    const frame_sample & last = stats.last();
+    render->color(0.0, 0.0, 0.0);
+    for(int r = 0; r < NUM_DRAW_ROUTINES; r++)
+    {
+        draw_routine routine = draw_routine(r);
+        double p95 = stats.percentile(routine, 95, VIEW);
+        if(r != DRAW_FRAME && p95 <= 0)
+            continue;
+        snprintf(text, sizeof(text), "%-12s p50 %6.2f  p95 %6.2f  p99 %6.2f ms", draw_routine_name(routine),
+                 stats.percentile(routine, 50, VIEW), p95, stats.percentile(routine, 99, VIEW));
+        render->text(left + 0.05, top - 0.1 - 0.07*line++, text);
+    }
+    snprintf(text, sizeof(text), "%d draw calls  %d vertices  %d labels  %d texture binds",
+             last.draw_calls, last.vertices, last.labels, last.texture_binds);
+    render->text(left + 0.05, top - 0.1 - 0.07*line++, text);
+    return;
+}
+
+void attractor::draw_labels()
+{
+    stats_timer timer(stats, DRAW_LABELS);
+    texture_2d curr_texture;
+    double matrix[16], aspect_x = 1.0, aspect_y = 1.0;
+    double x_pos, y_pos, half_width, half_height;
+    vector<GLfloat> vertices; // x, y, z, u, v
+    GLuint texture_id = 0;
+    
+    switch(VIEW)
+    {
+        case MANIFOLD:
+        case RECONSTRUCTION:
+        case GENERIC_RECONSTRUCTION:
+        case SHADOW:
+        case UNIVARIATE:
+        case UNIVARIATE_TS:
+        case XMAP:
+        case XMAP_TS:
+            break;
+        case TIME_SERIES:
+        case LAGS:
+            if(window_width > window_height)
+            {
+                aspect_x = double(window_height)/double(window_width);
+            }
+            else
+            {
+                aspect_y = double(window_width)/double(window_height);
+            }
+            break;
+        default:
+            return;
+    }
+    
+    // sort textures by depth
+    sort(texture_queue.begin(), texture_queue.end());
+    
+    // every label is a quad transformed on the CPU, all of them drawn with the atlas
+    // in one call (one per texture if some are not in the atlas)
+    matrices.push();
+    matrices.load_identity();
+    render->color(1.0, 1.0, 1.0);
+    for(vector<texture_label>::iterator iter = texture_queue.begin(); iter != texture_queue.end(); iter++)
+    {
+        curr_texture = my_textures[iter->index];
+        if(curr_texture.texture_id != texture_id && !vertices.empty())
+        {
+            render->texture(texture_id);
+            render->vertex_array(0, 3, 5*sizeof(GLfloat), &vertices[0]);
+            render->tex_coord_array(0, 2, 5*sizeof(GLfloat), &vertices[3]);
+            render->draw_arrays(GL_QUADS, 0, vertices.size()/5);
+            stats.count_texture_bind();
+            stats.count_draw(vertices.size()/5);
+            vertices.clear();
+        }
+        texture_id = curr_texture.texture_id;
+        
+        // billboard, aspect correction and scale
+        for(int i = 0; i < 16; i++)
+            matrix[i] = iter->billboard_matrix[i];
+        for(int i = 0; i < 4; i++)
+        {
+            matrix[i] *= aspect_x * iter->scale;
+            matrix[4+i] *= aspect_y * iter->scale;
+        }
+        
+        x_pos = curr_texture.width/2.0*(1-iter->x_peg);
+        y_pos = curr_texture.height/2.0*(iter->y_peg-1);
+        half_width = curr_texture.width/2.0;
+        half_height = curr_texture.height/2.0;
+        double corners[4][4] = {{-half_width+x_pos, -half_height+y_pos, curr_texture.u0, curr_texture.v0},
+                                {-half_width+x_pos, half_height+y_pos, curr_texture.u0, curr_texture.v1},
+                                {half_width+x_pos, half_height+y_pos, curr_texture.u1, curr_texture.v1},
+                                {half_width+x_pos, -half_height+y_pos, curr_texture.u1, curr_texture.v0}};
+        for(int c = 0; c < 4; c++)
+        {
+            for(int i = 0; i < 3; i++)
+                vertices.push_back(matrix[i]*corners[c][0] + matrix[4+i]*corners[c][1] + matrix[12+i]);
+            vertices.push_back(corners[c][2]);
+            vertices.push_back(corners[c][3]);
+        }
+    }
+    if(!vertices.empty())
+    {
+        render->texture(texture_id);
+        render->vertex_array(0, 3, 5*sizeof(GLfloat), &vertices[0]);
+        render->tex_coord_array(0, 2, 5*sizeof(GLfloat), &vertices[3]);
+        render->draw_arrays(GL_QUADS, 0, vertices.size()/5);
+        stats.count_texture_bind();
+        stats.count_draw(vertices.size()/5);
+    }
+    stats.count_labels(texture_queue.size());
+    render->disable_arrays();
+    render->texture(0);
+    matrices.pop();
+    return;
+}
+
+void attractor::enqueue_label(double pos_x, double pos_y, double pos_z, int texture_index, double scale, int x_peg, int y_peg)
+{
+    
+    // get camera position and vectors
+    double modelview_matrix[16], billboard_matrix[16], curr_matrix[16];
+    double camera_pos[3], new_camera_pos[3], pos[3];
+    double camera_up[3], look[3];
+    double bb_up[3], bb_right[3];
+    double temp;
+    
+    // save in curr_label
+    texture_label curr_label;
+    
+    matrices.get(GL_MODELVIEW, modelview_matrix);
+    matrices.get(GL_MODELVIEW, curr_matrix);
+    
     // save id
     curr_label.index = texture_index;
     
@@ -2205,16 +2946,8 @@ void attractor::enqueue_label(double pos_x, double pos_y, double pos_z, int text
     billboard_matrix[14] = pos_z;
     billboard_matrix[15] = 1;
     
-    // compute combined matrix and depth
-    glPushMatrix();
-    glLoadIdentity();
-    
-    // apply both transformations
-    glMultMatrixd(curr_matrix);
-    glMultMatrixd(billboard_matrix);
-    
-    // store single transformation matrix
-    glGetDoublev(GL_MODELVIEW_MATRIX, curr_label.billboard_matrix);
+    // compute combined matrix and depth, store single transformation matrix
+    multiply_matrix(curr_matrix, billboard_matrix, curr_label.billboard_matrix);
     
     
     for(int i=0; i<3; i++)
@@ -2234,8 +2967,6 @@ void attractor::enqueue_label(double pos_x, double pos_y, double pos_z, int text
     curr_label.x_peg = x_peg;
     curr_label.y_peg = y_peg;
     
-    glPopMatrix();   
-    
     texture_queue.push_back(curr_label);
     return;
 }
@@ -2243,6 +2974,7 @@ void attractor::enqueue_label(double pos_x, double pos_y, double pos_z, int text
 void attractor::draw_curve(const double x1, const double y1, const double z1, const double x2, const double y2, const double z2)
 {
     double ctrl_points[4][3];
+    const double* m = matrices.top(GL_MODELVIEW);
     ctrl_points[0][0] = x1;
     ctrl_points[0][1] = y1;
     ctrl_points[0][2] = z1;
@@ -2259,19 +2991,106 @@ void attractor::draw_curve(const double x1, const double y1, const double z1, co
     ctrl_points[2][1] = 0.5 * ctrl_points[0][1] + 0.5 * ctrl_points[3][1];
     ctrl_points[2][2] = 0.2 * ctrl_points[0][2] + 0.8 * ctrl_points[3][2];
     
-    glMap1d(GL_MAP1_VERTEX_3, 0.0, 1.0, 3, 4, &ctrl_points[0][0]);
-    glEnable(GL_MAP1_VERTEX_3);
+    // queue in eye coordinates, the modelview is affine so the curve maps to the
+    // curve of the mapped control points
+    for(int i = 0; i < 4; i++)
+    {
+        for(int k = 0; k < 3; k++)
+            curve_queue.push_back(m[k]*ctrl_points[i][0] + m[4+k]*ctrl_points[i][1] + m[8+k]*ctrl_points[i][2] + m[12+k]);
+    }
+    return;
+}
+
+void attractor::draw_curves()
+{
+    stats_timer timer(stats, DRAW_CURVES);
+    vector<GLfloat> vertices;
+    
+    if(curve_queue.empty())
+        return;
     
-    glColor4dv(neighbor_color);
-    glLineWidth(scale * LINE_WIDTH);
-    glBegin(GL_LINE_STRIP);
-    for (int i = 0; i <= 50; i++)
+    // evaluate every queued curve with the Bernstein table, as one line list
+    vertices.reserve(curve_queue.size() / 12 * CURVE_SEGMENTS * 6);
+    for(int c = 0; c < curve_queue.size(); c += 12)
     {
-        glEvalCoord1d(double(i)/50.0);
+        const double* p = &curve_queue[c];
+        GLfloat point[CURVE_SEGMENTS+1][3];
+        for(int i = 0; i <= CURVE_SEGMENTS; i++)
+        {
+            const double* b = bezier_basis[i];
+            for(int k = 0; k < 3; k++)
+                point[i][k] = b[0]*p[k] + b[1]*p[3+k] + b[2]*p[6+k] + b[3]*p[9+k];
+        }
+        for(int i = 0; i < CURVE_SEGMENTS; i++)
+        {
+            vertices.insert(vertices.end(), point[i], point[i]+3);
+            vertices.insert(vertices.end(), point[i+1], point[i+1]+3);
+        }
     }
-    glEnd();
-    glDisable(GL_MAP1_VERTEX_3);
     
+    matrices.push();
+    matrices.load_identity();
+    render->color(neighbor_color);
+    render->line_width(scale * LINE_WIDTH);
+    render->vertex_array(0, 3, 0, &vertices[0]);
+    render->draw_arrays(GL_LINES, 0, vertices.size()/3);
+    render->disable_arrays();
+    stats.count_draw(vertices.size()/3);
+    matrices.pop();
+    curve_queue.clear();
+    return;
+}
+
+void attractor::enqueue_marker(const double x, const double y, const double z, const double* rgba, const double size)
+{
+    enqueue_marker(x, y, z, rgba[0], rgba[1], rgba[2], rgba[3], size);
+    return;
+}
+
+void attractor::enqueue_marker(const double x, const double y, const double z,
+                               const double r, const double g, const double b, const double a, const double size)
+{
+    // the projection changes between the parts of some views, so markers are kept
+    // in normalized device coordinates
+    double m[16], clip[4];
+    multiply_matrix(matrices.top(GL_PROJECTION), matrices.top(GL_MODELVIEW), m);
+    for(int i = 0; i < 4; i++)
+        clip[i] = m[i]*x + m[4+i]*y + m[8+i]*z + m[12+i];
+    if(clip[3] <= 0)
+        return;
+    
+    marker_queue.push_back(clip[0]/clip[3]);
+    marker_queue.push_back(clip[1]/clip[3]);
+    marker_queue.push_back(clip[2]/clip[3]);
+    marker_queue.push_back(r);
+    marker_queue.push_back(g);
+    marker_queue.push_back(b);
+    marker_queue.push_back(a);
+    marker_queue.push_back(size);
+    return;
+}
+
+void attractor::draw_markers()
+{
+    stats_timer timer(stats, DRAW_MARKERS);
+    
+    if(marker_queue.empty())
+        return;
+    
+    // every current point, neighbor and prediction of the frame in one draw
+    matrices.mode(GL_PROJECTION);
+    matrices.push();
+    matrices.load_identity();
+    matrices.mode(GL_MODELVIEW);
+    matrices.push();
+    matrices.load_identity();
+    render->draw_markers(marker_queue);
+    stats.count_draw(marker_queue.size()/8);
+    matrices.pop();
+    matrices.mode(GL_PROJECTION);
+    matrices.pop();
+    matrices.mode(GL_MODELVIEW);
+    marker_queue.clear();
     return;
 }
 
@@ -2281,12 +3100,12 @@ void attractor::col(const double x, const double y, const double z)
     if(!COLOR_METHOD)
     {
         sat = x - d + (1-d);
-        glColor3d(sat, sat, sat);
+        render->color(sat, sat, sat);
     }
     else
     {
         sat = exp(-8*d * dist_to_curr(x, y, z));
-        glColor4d(0, 0, 0, sat);
+        render->color(0, 0, 0, sat);
     }
     return;
 }
@@ -2458,267 +3277,231 @@ void attractor::transform_data()
 	return;
 }
 
-void attractor::generate_xmaps()
+void attractor::generate_xmaps(ccm_data & data)
 {
     for(int frame = 0; frame < num_points; frame++)
     {
-        x_nn_weights[frame].resize(nn_num, -1);
-        y_nn_weights[frame].resize(nn_num, -1);
-        z_nn_weights[frame].resize(nn_num, -1);
+        data.x_nn_weights[frame].resize(data.nn_num, -1);
+        data.y_nn_weights[frame].resize(data.nn_num, -1);
+        data.z_nn_weights[frame].resize(data.nn_num, -1);
     }
     
-    find_neighbors(1);
-    find_neighbors(2);
-    find_neighbors(3);
+    find_neighbors(data, 1);
+    find_neighbors(data, 2);
+    find_neighbors(data, 3);
+    if(rebuild_cancelled())
+        return;
     
-    double total_weight;
-    vector<double>::iterator weight_iter;
-    vector<int>::iterator index_iter;
-    double pred_x, pred_y, pred_z;
-    
-    for(int frame = 2*tau + nn_skip*(nn_num-1); frame < num_points; frame++)
-    {
-        total_weight = 0;
-        pred_y = 0;
-        pred_z = 0;
-        for(index_iter = x_nn_indices[frame].begin(), weight_iter = x_nn_weights[frame].begin(); 
-            (index_iter != x_nn_indices[frame].end()) && (weight_iter != x_nn_weights[frame].end());
-            index_iter++, weight_iter++)
-        {
-            pred_y += y[*index_iter] * (*weight_iter);
-            pred_z += z[*index_iter] * (*weight_iter);
-            total_weight += (*weight_iter);
-        }
-        x_xmap_y[frame] = pred_y / total_weight;
-        x_xmap_z[frame] = pred_z / total_weight;
-        
-        total_weight = 0;
-        pred_x = 0;
-        pred_z = 0;
-        for(index_iter = y_nn_indices[frame].begin(), weight_iter = y_nn_weights[frame].begin(); 
-            (index_iter != y_nn_indices[frame].end()) && (weight_iter != y_nn_weights[frame].end());
-            index_iter++, weight_iter++)
-        {
-            pred_x += x[*index_iter] * (*weight_iter);
-            pred_z += z[*index_iter] * (*weight_iter);
-            total_weight += (*weight_iter);
-        }
-        y_xmap_x[frame] = pred_x / total_weight;
-        y_xmap_z[frame] = pred_z / total_weight;
-        
-        total_weight = 0;
-        pred_x = 0;
-        pred_y = 0;
-        for(index_iter = z_nn_indices[frame].begin(), weight_iter = z_nn_weights[frame].begin(); 
-            (index_iter != z_nn_indices[frame].end()) && (weight_iter != z_nn_weights[frame].end());
-            index_iter++, weight_iter++)
-        {
-            pred_x += x[*index_iter] * (*weight_iter);
-            pred_y += y[*index_iter] * (*weight_iter);
-            total_weight += (*weight_iter);
-        }
-        z_xmap_x[frame] = pred_x / total_weight;
-        z_xmap_y[frame] = pred_y / total_weight;        
-    }
+    generate_predictions(data);
     return;
 }
 
-void attractor::generate_forecasts()
-{    
-    double total_weight;
-    vector<double>::iterator weight_iter;
-    vector<int>::iterator index_iter;
-    double pred, pred_lag_1, pred_lag_2;
-    
-    for(int frame = 2*tau + nn_skip*(nn_num-1); frame < num_points-tp; frame++)
-    {
-        total_weight = 0;
-        pred = 0;
-        pred_lag_1 = 0;
-        pred_lag_2 = 0;
-        for(index_iter = x_nn_indices[frame].begin(), weight_iter = x_nn_weights[frame].begin(); 
-            (index_iter != x_nn_indices[frame].end()) && (weight_iter != x_nn_weights[frame].end());
-            index_iter++, weight_iter++)
+void attractor::generate_predictions(ccm_data & data)
+{
+    vector<vector<int> >* nn_indices[3] = {&data.x_nn_indices, &data.y_nn_indices, &data.z_nn_indices};
+    vector<vector<double> >* nn_weights[3] = {&data.x_nn_weights, &data.y_nn_weights, &data.z_nn_weights};
+    
+    // cross map of variable v from manifold m, NULL for v == m
+    vector<double>* xmap[3][3] = {{NULL, &data.x_xmap_y, &data.x_xmap_z},
+                                  {&data.y_xmap_x, NULL, &data.y_xmap_z},
+                                  {&data.z_xmap_x, &data.z_xmap_y, NULL}};
+    
+    // forecast of variable m at +tp, +tp-tau and +tp-2*tau from manifold m
+    vector<double>* forecast[3][3] = {{&data.x_forecast, &data.x_forecast_lag_1, &data.x_forecast_lag_2},
+                                      {&data.y_forecast, &data.y_forecast_lag_1, &data.y_forecast_lag_2},
+                                      {&data.z_forecast, &data.z_forecast_lag_1, &data.z_forecast_lag_2}};
+    const int lead[3] = {data.tp, data.tp - data.tau, data.tp - 2*data.tau};
+    
+    // x, y and z of a frame side by side, so one neighbor is one contiguous fetch
+    vector<double> xyz(3*num_points);
+    for(int frame = 0; frame < num_points; frame++)
+    {
+        xyz[3*frame] = x[frame];
+        xyz[3*frame+1] = y[frame];
+        xyz[3*frame+2] = z[frame];
+    }
+    
+    double total_weight, pred[3], future[3];
+    const double* p;
+    
+    for(int frame = 2*data.tau + data.nn_skip*(data.nn_num-1); frame < num_points; frame++)
+    {
+        bool do_forecast = frame < num_points - data.tp;
+        
+        for(int m = 0; m < 3; m++)
         {
-            if(*index_iter < num_points-tp)
+            const int k = (*nn_indices[m])[frame].size();
+            if(k == 0)
+                continue;
+            const int* indices = &(*nn_indices[m])[frame][0];
+            double* weights = &(*nn_weights[m])[frame][0];
+            
+            // normalize once, so every gather below is a plain weighted sum
+            total_weight = 0;
+            for(int i = 0; i < k; i++)
+                total_weight += weights[i];
+            for(int i = 0; i < k; i++)
+                weights[i] /= total_weight;
+            
+            pred[0] = pred[1] = pred[2] = 0;
+            future[0] = future[1] = future[2] = 0;
+            for(int i = 0; i < k; i++)
             {
-                pred += x[(*index_iter)+tp] * (*weight_iter);
-                pred_lag_1 += x[(*index_iter)+tp-tau] * (*weight_iter);
-                pred_lag_2 += x[(*index_iter)+tp-2*tau] * (*weight_iter);
-                total_weight += (*weight_iter);
+                p = &xyz[3*indices[i]];
+                pred[0] += p[0] * weights[i];
+                pred[1] += p[1] * weights[i];
+                pred[2] += p[2] * weights[i];
+                if(do_forecast)
+                {
+                    future[0] += p[3*lead[0] + m] * weights[i];
+                    future[1] += p[3*lead[1] + m] * weights[i];
+                    future[2] += p[3*lead[2] + m] * weights[i];
+                }
+            }
+            
+            for(int v = 0; v < 3; v++)
+            {
+                if(v != m)
+                    (*xmap[m][v])[frame] = pred[v];
+            }
+            if(do_forecast)
+            {
+                (*forecast[m][0])[frame+data.tp] = future[0];
+                (*forecast[m][1])[frame+data.tp] = future[1];
+                (*forecast[m][2])[frame+data.tp] = future[2];
             }
         }
-        x_forecast[frame+tp] = pred / total_weight;
-        x_forecast_lag_1[frame+tp] = pred_lag_1 / total_weight;
-        x_forecast_lag_2[frame+tp] = pred_lag_2 / total_weight;
-        
-        total_weight = 0;
-        pred = 0;
-        pred_lag_1 = 0;
-        pred_lag_2 = 0;
-        for(index_iter = y_nn_indices[frame].begin(), weight_iter = y_nn_weights[frame].begin(); 
-            (index_iter != y_nn_indices[frame].end()) && (weight_iter != y_nn_weights[frame].end());
-            index_iter++, weight_iter++)
-        {
-            pred += y[(*index_iter)+tp] * (*weight_iter);
-            pred_lag_1 += y[(*index_iter)+tp-tau] * (*weight_iter);
-            pred_lag_2 += y[(*index_iter)+tp-2*tau] * (*weight_iter);
-            total_weight += (*weight_iter);
-        }
-        y_forecast[frame+tp] = pred / total_weight;
-        y_forecast_lag_1[frame+tp] = pred_lag_1 / total_weight;
-        y_forecast_lag_2[frame+tp] = pred_lag_2 / total_weight;
-        
-        total_weight = 0;
-        pred = 0;
-        pred_lag_1 = 0;
-        pred_lag_2 = 0;
-        for(index_iter = z_nn_indices[frame].begin(), weight_iter = z_nn_weights[frame].begin(); 
-            (index_iter != z_nn_indices[frame].end()) && (weight_iter != z_nn_weights[frame].end());
-            index_iter++, weight_iter++)
-        {
-            pred += z[(*index_iter)+tp] * (*weight_iter);
-            pred_lag_1 += z[(*index_iter)+tp-tau] * (*weight_iter);
-            pred_lag_2 += z[(*index_iter)+tp-2*tau] * (*weight_iter);
-            total_weight += (*weight_iter);
-        }
-        z_forecast[frame+tp] = pred / total_weight;
-        z_forecast_lag_1[frame+tp] = pred_lag_1 / total_weight;
-        z_forecast_lag_2[frame+tp] = pred_lag_2 / total_weight;
     }
     return;
 }
 
 void attractor::load_textures()
 {
-    texture_2d curr_texture;
+    static const char* filenames[] = {
+        "x_label.png", "x_t_label.png", "x_t-tau_label.png", "x_t-2tau_label.png",
+        "y_label.png", "y_t_label.png", "y_t-tau_label.png", "y_t-2tau_label.png",
+        "z_label.png", "z_t_label.png", "z_t-tau_label.png", "z_t-2tau_label.png",
+        "m_label.png", "m_x_label.png", "m_y_label.png", "m_z_label.png",
+        "tau_label.png", "2tau_label.png", "view_1_label.png", "view_2_label.png",
+        "view_3_x_label.png", "view_3_y_label.png", "view_3_z_label.png", "view_4_x_label.png",
+        "view_4_y_label.png", "view_4_z_label.png", "view_5_x_label.png", "view_5_y_label.png",
+        "view_5_z_label.png", "view_6_x_label.png", "view_6_y_label.png", "view_6_z_label.png",
+        "view_7_xy_label.png", "view_7_xz_label.png", "view_7_yx_label.png", "view_7_yz_label.png",
+        "view_7_zx_label.png", "view_7_zy_label.png", "equations_label.png", "takens_theorem.png"};
+    const int num_textures = sizeof(filenames) / sizeof(filenames[0]);
+    vector<png_byte> images[VIEW_1_LABEL_TEXTURE];
+    vector<png_byte> atlas;
+    vector<pair<int, int> > by_height;
+    int atlas_x[VIEW_1_LABEL_TEXTURE], atlas_y[VIEW_1_LABEL_TEXTURE];
+    int x = ATLAS_PADDING, y = ATLAS_PADDING, shelf = 0, atlas_height;
+    GLuint atlas_id;
     
     my_textures.clear();
+    my_textures.resize(num_textures);
     
-    curr_texture.texture_id = load_texture("x_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("x_t_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("x_t-tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("x_t-2tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("y_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("y_t_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("y_t-tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("y_t-2tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("z_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("z_t_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("z_t-tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("z_t-2tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("m_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("m_x_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("m_y_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("m_z_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("2tau_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_1_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_2_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_3_x_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_3_y_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_3_z_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_4_x_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_4_y_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_4_z_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_5_x_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_5_y_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_5_z_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_6_x_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_6_y_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_6_z_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_7_xy_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_7_xz_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_7_yx_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
-    
-    curr_texture.texture_id = load_texture("view_7_yz_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
+    // the billboard labels share one atlas, packed on shelves from the tallest down;
+    // every label starts and ends on a multiple of ATLAS_PADDING with at least that
+    // much empty space around it, so the mipmaps never mix two labels; one too wide
+    // for a shelf gets its own texture
+    for(int i = 0; i < VIEW_1_LABEL_TEXTURE; i++)
+    {
+        texture_2d & t = my_textures[i];
+        t.width = t.height = 0;
+        read_png(filenames[i], t.width, t.height, images[i]);
+        atlas_x[i] = -1;
+        if(t.width > ATLAS_WIDTH - 2*ATLAS_PADDING)
+        {
+            cerr << "WARNING (attractor): " << filenames[i] << " is wider than the label atlas, using its own texture.\n";
+            continue;
+        }
+        by_height.push_back(make_pair(-t.height, i));
+    }
+    sort(by_height.begin(), by_height.end());
+    for(int k = 0; k < by_height.size(); k++)
+    {
+        int i = by_height[k].second;
+        int w = (my_textures[i].width + ATLAS_PADDING-1) / ATLAS_PADDING * ATLAS_PADDING;
+        int h = (my_textures[i].height + ATLAS_PADDING-1) / ATLAS_PADDING * ATLAS_PADDING;
+        if(x + w + ATLAS_PADDING > ATLAS_WIDTH)
+        {
+            x = ATLAS_PADDING;
+            y += shelf + ATLAS_PADDING;
+            shelf = 0;
+        }
+        atlas_x[i] = x;
+        atlas_y[i] = y;
+        x += w + ATLAS_PADDING;
+        shelf = max(shelf, h);
+    }
+    atlas_height = y + shelf + ATLAS_PADDING;
     
-    curr_texture.texture_id = load_texture("view_7_zx_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
+    atlas.resize(4 * ATLAS_WIDTH * atlas_height, 0);
+    for(int i = 0; i < VIEW_1_LABEL_TEXTURE; i++)
+    {
+        texture_2d & t = my_textures[i];
+        if(atlas_x[i] < 0)
+            continue;
+        for(int row = 0; row < t.height; row++)
+            copy(&images[i][4 * row * t.width], &images[i][4 * (row+1) * t.width], &atlas[4 * ((atlas_y[i] + row) * ATLAS_WIDTH + atlas_x[i])]);
+    }
+    atlas_id = make_texture(&atlas[0], ATLAS_WIDTH, atlas_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_MIPMAPS);
+    for(int i = 0; i < VIEW_1_LABEL_TEXTURE; i++)
+    {
+        texture_2d & t = my_textures[i];
+        if(atlas_x[i] < 0)
+        {
+            t.texture_id = make_texture(&images[i][0], t.width, t.height);
+            t.u0 = t.v0 = 0;
+            t.u1 = t.v1 = 1;
+            continue;
+        }
+        t.texture_id = atlas_id;
+        t.u0 = double(atlas_x[i]) / ATLAS_WIDTH;
+        t.v0 = double(atlas_y[i]) / atlas_height;
+        t.u1 = double(atlas_x[i] + t.width) / ATLAS_WIDTH;
+        t.v1 = double(atlas_y[i] + t.height) / atlas_height;
+    }
     
-    curr_texture.texture_id = load_texture("view_7_zy_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
+    // slide sized textures are drawn one at a time and keep their own
+    for(int i = VIEW_1_LABEL_TEXTURE; i < num_textures; i++)
+    {
+        texture_2d & t = my_textures[i];
+        t.texture_id = load_texture(filenames[i], t.width, t.height);
+        t.u0 = t.v0 = 0;
+        t.u1 = t.v1 = 1;
+    }
     
-    curr_texture.texture_id = load_texture("equations_label.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
+	return;
+}
+
+GLuint attractor::load_texture(const string filename, int &width, int &height)
+{
+    vector<png_byte> image;
     
-    curr_texture.texture_id = load_texture("takens_theorem.png", curr_texture.width, curr_texture.height);
-    my_textures.push_back(curr_texture);
+    width = height = 0;
+    if(!read_png(filename, width, height, image))
+        return 0;
+    return make_texture(&image[0], width, height);
+}
+
+GLuint attractor::make_texture(const png_byte* image_data, const int width, const int height)
+{
+    //generate the OpenGL texture object
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) image_data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     
-    return;
+    return texture;
 }
 
-GLuint attractor::load_texture(const string filename, int &width, int &height) 
+bool attractor::read_png(const string filename, int &width, int &height, vector<png_byte> & image)
 {
     
     //header for testing if it is a png
@@ -2727,7 +3510,7 @@ GLuint attractor::load_texture(const string filename, int &width, int &height)
     //open file as binary
     FILE *fp = fopen(filename.c_str(), "rb");
     if (!fp) {
-        return 0;
+        return false;
     }
     
     //read the header
@@ -2737,7 +3520,7 @@ GLuint attractor::load_texture(const string filename, int &width, int &height)
     int is_png = !png_sig_cmp(header, 0, 8);
     if (!is_png) {
         fclose(fp);
-        return 0;
+        return false;
     }
     
     //create png struct
@@ -2745,7 +3528,7 @@ GLuint attractor::load_texture(const string filename, int &width, int &height)
                                                  NULL, NULL);
     if (!png_ptr) {
         fclose(fp);
-        return 0;
+        return false;
     }
     
     //create png info struct
@@ -2753,7 +3536,7 @@ GLuint attractor::load_texture(const string filename, int &width, int &height)
     if (!info_ptr) {
         png_destroy_read_struct(&png_ptr, (png_infopp) NULL, (png_infopp) NULL);
         fclose(fp);
-        return 0;
+        return false;
     }
     
     //create png info struct
@@ -2761,14 +3544,14 @@ GLuint attractor::load_texture(const string filename, int &width, int &height)
     if (!end_info) {
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp) NULL);
         fclose(fp);
-        return 0;
+        return false;
     }
     
     //png error stuff, not sure libpng man suggests this.
     if (setjmp(png_jmpbuf(png_ptr))) {
         png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
         fclose(fp);
-        return 0;
+        return false;
     }
     
     //init png reading
@@ -2798,87 +3581,117 @@ GLuint attractor::load_texture(const string filename, int &width, int &height)
     // Row size in bytes.
     int rowbytes = png_get_rowbytes(png_ptr, info_ptr);
     
-    // Allocate the image_data as a big block, to be given to opengl
-    png_byte *image_data = new png_byte[rowbytes * height];
-    if (!image_data) {
-        //clean up memory and close stuff
-        png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-        fclose(fp);
-        return 0;
-    }
+    // Allocate the image as a big block, to be given to opengl
+    image.resize(rowbytes * height);
     
     //row_pointers is for pointing to image_data for reading the png with libpng
     png_bytep *row_pointers = new png_bytep[height];
     if (!row_pointers) {
         //clean up memory and close stuff
         png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-        delete[] image_data;
         fclose(fp);
-        return 0;
+        return false;
     }
     // set the individual row_pointers to point at the correct offsets of image_data
     for (int i = 0; i < height; ++i)
-        row_pointers[height - 1 - i] = image_data + i * rowbytes;
+        row_pointers[height - 1 - i] = &image[0] + i * rowbytes;
     
     //read the png into image_data through row_pointers
     png_read_image(png_ptr, row_pointers);
     
-    //Now generate the OpenGL texture object
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) image_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    
     //clean up memory and close stuff
     png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-    delete[] image_data;
     delete[] row_pointers;
     fclose(fp);
     
-    return texture;
+    return true;
 }
 
-void attractor::find_neighbors(const int dim)
+void attractor::load_shaders()
+{
+    embedding_program = render->load_program(embedding_vertex_shader);
+    if(embedding_program == 0)
+    {
+        cerr << "WARNING (attractor): could not build the trajectory shaders, using fixed-function colors.\n";
+        return;
+    }
+    current_point_location = glGetUniformLocation(embedding_program, "current_point");
+    color_method_location = glGetUniformLocation(embedding_program, "color_method");
+    render->use_program(embedding_program);
+    glUniform1f(glGetUniformLocation(embedding_program, "d"), d);
+    render->use_program(0);
+    
+    series_program = render->load_program(series_vertex_shader);
+    if(series_program == 0)
+    {
+        cerr << "WARNING (attractor): could not build the time series shaders, drawing them vertex by vertex.\n";
+        return;
+    }
+    time_transform_location = glGetUniformLocation(series_program, "time_transform");
+    fade_location = glGetUniformLocation(series_program, "fade");
+    sat_location = glGetUniformLocation(series_program, "sat");
+    return;
+}
+
+void attractor::find_neighbors(ccm_data & data, const int dim)
 {
     vector<double>::iterator x_i, y_i, z_i;
     vector<int> nn_indices;
     vector<double> nn_distances;
+    vector<double> nn_weights(data.nn_num);
 	double temp_distance;
 	int temp_rank, temp_index;
     double curr_x, curr_y, curr_z;
     int index;
+    grid_nn* grid = NULL;
+    vector<int> grid_indices(data.nn_num);
+    vector<double> grid_distances(data.nn_num);
     
     // select right time series
     switch(dim)
     {
         case 1:
             x_i = x.begin();
-            y_i = x.begin() + tau;
-            z_i = x.begin() + 2*tau;
+            y_i = x.begin() + data.tau;
+            z_i = x.begin() + 2*data.tau;
             break;
         case 2:
             x_i = y.begin();
-            y_i = y.begin() + tau;
-            z_i = y.begin() + 2*tau;
+            y_i = y.begin() + data.tau;
+            z_i = y.begin() + 2*data.tau;
             break;
         case 3:
             x_i = z.begin();
-            y_i = z.begin() + tau;
-            z_i = z.begin() + 2*tau;
+            y_i = z.begin() + data.tau;
+            z_i = z.begin() + 2*data.tau;
             break;
         default:
             cerr << "ERROR (attractor): invalid dimension given to find_neighbors, dim = " << dim << ".\n";
             exit(1);
     }
     
-    for(int frame = 2*tau, my_frame = 0; frame < num_points; frame++, my_frame++)
+    // transform_data() puts every coordinate inside [0, 2d]
+    if(nn_method != NN_BRUTE && num_points > 2*data.tau)
+        grid = new grid_nn(&*x_i, &*y_i, &*z_i, num_points - 2*data.tau, 0, 2*d, data.nn_skip);
+    
+    // optionally visit the frames in Morton order of their query points, so that
+    // consecutive searches touch the same cells; the results are the same
+    const vector<int>* order = NULL;
+    if(grid && MORTON_ORDER)
+        order = &grid->spatial_order();
+    
+    for(int q = 0, frame, my_frame; q < num_points - 2*data.tau; q++)
     {
-        if(my_frame >= nn_skip*nn_num)
+        if(q % 256 == 0 && rebuild_cancelled())
+        {
+            delete grid;
+            return;
+        }
+        
+        // the query point of my_frame is point my_frame-1
+        my_frame = order ? (*order)[q] + 1 : q;
+        frame = my_frame + 2*data.tau;
+        if(frame < num_points && my_frame >= data.nn_skip*data.nn_num)
         {
             nn_indices.clear();
             nn_distances.clear();
@@ -2887,89 +3700,214 @@ void attractor::find_neighbors(const int dim)
             curr_y = *(y_i + my_frame-1);
             curr_z = *(z_i + my_frame-1);
             
-            // initialize neighbors
-            index = my_frame - nn_skip;
-            for(int i = 0; i < nn_num; i++, index -= nn_skip)
+            if(grid)
             {
-                nn_indices.push_back(index + 2*tau);
-                nn_distances.push_back(dist(*(x_i + index), *(y_i + index), *(z_i + index), curr_x, curr_y, curr_z));
+                grid->query(curr_x, curr_y, curr_z, my_frame - data.nn_skip, data.nn_num, &grid_indices[0], &grid_distances[0]);
+                for(int i = 0; i < data.nn_num; i++)
+                {
+                    nn_indices.push_back(grid_indices[i] + 2*data.tau);
+                    nn_distances.push_back(sqrt(grid_distances[i]));
+                }
             }
-            
-            // sort distances
-            for(int i = 0; i < nn_num; i++)
+            else
             {
-                for(int j = nn_num-1; j > i; j--)
+                // initialize neighbors
+                index = my_frame - data.nn_skip;
+                for(int i = 0; i < data.nn_num; i++, index -= data.nn_skip)
                 {
-                    if(nn_distances[j] < nn_distances[j-1])
-                    {
-                        temp_distance = nn_distances[j];
-                        nn_distances[j] = nn_distances[j-1];
-                        nn_distances[j-1] = temp_distance;
-                        temp_index = nn_indices[j];
-                        nn_indices[j] = nn_indices[j-1];
-                        nn_indices[j-1] = temp_index;
-                    }
-                } 
-            }
+                    nn_indices.push_back(index + 2*data.tau);
+                    nn_distances.push_back(dist(*(x_i + index), *(y_i + index), *(z_i + index), curr_x, curr_y, curr_z));
+                }
             
-            // search for nn_num nearest neighbors
-            for(int i = index; i >= 0; i-=nn_skip)
-            {
-                temp_distance = dist(*(x_i + i), *(y_i + i), *(z_i + i), curr_x, curr_y, curr_z);
-                temp_rank = nn_num;
-                for(vector<double>::reverse_iterator j = nn_distances.rbegin(); j < nn_distances.rend(); j++, temp_rank--)
+                // sort distances
+                for(int i = 0; i < data.nn_num; i++)
                 {
-                    if(temp_distance > *j)
+                    for(int j = data.nn_num-1; j > i; j--)
                     {
-                        break;
-                    }	
+                        if(nn_distances[j] < nn_distances[j-1])
+                        {
+                            temp_distance = nn_distances[j];
+                            nn_distances[j] = nn_distances[j-1];
+                            nn_distances[j-1] = temp_distance;
+                            temp_index = nn_indices[j];
+                            nn_indices[j] = nn_indices[j-1];
+                            nn_indices[j-1] = temp_index;
+                        }
+                    } 
                 }
-                if(temp_rank < nn_num)
+            
+                // search for nn_num nearest neighbors
+                for(int i = index; i >= 0; i-=data.nn_skip)
                 {
-                    nn_distances.insert(nn_distances.begin()+temp_rank, temp_distance);
-                    nn_indices.insert(nn_indices.begin()+temp_rank, i + 2*tau);
-                    nn_distances.pop_back();
-                    nn_indices.pop_back();				
+                    temp_distance = dist(*(x_i + i), *(y_i + i), *(z_i + i), curr_x, curr_y, curr_z);
+                    temp_rank = data.nn_num;
+                    for(vector<double>::reverse_iterator j = nn_distances.rbegin(); j < nn_distances.rend(); j++, temp_rank--)
+                    {
+                        if(temp_distance > *j)
+                        {
+                            break;
+                        }	
+                    }
+                    if(temp_rank < data.nn_num)
+                    {
+                        nn_distances.insert(nn_distances.begin()+temp_rank, temp_distance);
+                        nn_indices.insert(nn_indices.begin()+temp_rank, i + 2*data.tau);
+                        nn_distances.pop_back();
+                        nn_indices.pop_back();				
+                    }
                 }
             }
             
-            // compute simplex weights
+            // compute simplex weights; a neighbor on top of the query point takes all of them
+            for(int i = 0; i < data.nn_num; i++)
+            {
+                if(nn_distances[0] > 0)
+                    nn_weights[i] = exp(-nn_distances[i] / nn_distances[0]);
+                else
+                    nn_weights[i] = (nn_distances[i] == 0) ? 1.0 : 0.0;
+                if(nn_weights[i] < 0.00001)
+                    nn_weights[i] = 0.00001;
+            }
             switch(dim)
             {
                 case 1:
-                    for(int i = 0; i < nn_num; i++)
-                    {
-                        x_nn_weights[frame][i] = exp(-nn_distances[i] / nn_distances[0]);
-                        if(x_nn_weights[frame][i] < 0.00001)
-                            x_nn_weights[frame][i] = 0.00001;
-                    }
-                    x_nn_indices[frame] = nn_indices;
+                    data.x_nn_weights[frame] = nn_weights;
+                    data.x_nn_indices[frame] = nn_indices;
                     break;
                 case 2:
-                    for(int i = 0; i < nn_num; i++)
-                    {
-                        y_nn_weights[frame][i] = exp(-nn_distances[i] / nn_distances[0]);
-                        if(y_nn_weights[frame][i] < 0.00001)
-                            y_nn_weights[frame][i] = 0.00001;
-                    }
-                    y_nn_indices[frame] = nn_indices;
+                    data.y_nn_weights[frame] = nn_weights;
+                    data.y_nn_indices[frame] = nn_indices;
                     break;
                 case 3:
-                    for(int i = 0; i < nn_num; i++)
-                    {
-                        z_nn_weights[frame][i] = exp(-nn_distances[i] / nn_distances[0]);
-                        if(z_nn_weights[frame][i] < 0.00001)
-                            z_nn_weights[frame][i] = 0.00001;
-                    }
-                    z_nn_indices[frame] = nn_indices;
+                    data.z_nn_weights[frame] = nn_weights;
+                    data.z_nn_indices[frame] = nn_indices;
                     break;
             }
         }
     }
     
+    delete grid;
+    return;
+}
+
+void* attractor::rebuild_worker(void* arg)
+{
+    attractor* a = (attractor*) arg;
+    
+    cerr << "rebuilding cross maps (tau = " << a->ccm_back.tau << ", nn_num = " << a->ccm_back.nn_num 
+         << ", nn_skip = " << a->ccm_back.nn_skip << ")...";
+    a->generate_xmaps(a->ccm_back);
+    
+    pthread_mutex_lock(&a->rebuild_mutex);
+    if(!a->rebuild_cancel)
+    {
+        a->rebuild_ready = true;
+        cerr << "done!\n";
+    }
+    else
+    {
+        cerr << "cancelled!\n";
+    }
+    pthread_mutex_unlock(&a->rebuild_mutex);
+    return NULL;
+}
+
+bool attractor::next_parameters_fit()
+{
+    // the first frame with neighbors, as in find_neighbors
+    if(2*next_tau + next_nn_skip*next_nn_num < num_points)
+        return true;
+    cerr << "WARNING (attractor): tau = " << next_tau << ", nn_num = " << next_nn_num << ", nn_skip = " << next_nn_skip
+         << " leave no frames with neighbors, keeping the current cross maps.\n";
+    return false;
+}
+
+void attractor::start_rebuild()
+{
+    // abandon any rebuild already in flight
+    stop_rebuild();
+    
+    if(next_tau == ccm.tau && next_nn_num == ccm.nn_num && next_nn_skip == ccm.nn_skip)
+        return;
+    
+    // the displayed snapshot is untouched until swap_rebuild()
+    ccm_back = ccm_data();
+    ccm_back.tau = next_tau;
+    ccm_back.tp = tp;
+    ccm_back.nn_num = next_nn_num;
+    ccm_back.nn_skip = next_nn_skip;
+    ccm_back.resize(num_points);
+    
+    rebuild_cancel = false;
+    rebuild_ready = false;
+    if(pthread_create(&rebuild_thread, NULL, rebuild_worker, this) != 0)
+    {
+        cerr << "ERROR (attractor): unable to start cross map rebuild, computing in place.\n";
+        generate_xmaps(ccm_back);
+        rebuild_ready = true;
+        swap_rebuild();
+        return;
+    }
+    rebuild_running = true;
+    return;
+}
+
+void attractor::stop_rebuild()
+{
+    if(!rebuild_running)
+        return;
+    
+    pthread_mutex_lock(&rebuild_mutex);
+    rebuild_cancel = true;
+    pthread_mutex_unlock(&rebuild_mutex);
+    
+    pthread_join(rebuild_thread, NULL);
+    rebuild_running = false;
+    rebuild_ready = false;
+    ccm_back = ccm_data();
     return;
 }
 
+void attractor::swap_rebuild()
+{
+    if(!rebuild_finished())
+        return;
+    
+    if(rebuild_running)
+    {
+        pthread_join(rebuild_thread, NULL);
+        rebuild_running = false;
+    }
+    rebuild_ready = false;
+    
+    // swap snapshots and release the old one
+    ccm.swap(ccm_back);
+    ccm_back = ccm_data();
+    tau = ccm.tau;
+    reset_skill();
+    return;
+}
+
+bool attractor::rebuild_finished()
+{
+    bool ready;
+    
+    pthread_mutex_lock(&rebuild_mutex);
+    ready = rebuild_ready;
+    pthread_mutex_unlock(&rebuild_mutex);
+    return ready;
+}
+
+bool attractor::rebuild_cancelled()
+{
+    bool cancel;
+    
+    pthread_mutex_lock(&rebuild_mutex);
+    cancel = rebuild_cancel;
+    pthread_mutex_unlock(&rebuild_mutex);
+    return cancel;
+}
+
 void attractor::init(bool MOVIE_MODE)
 {
     // modify path to use local resource directory
@@ -2998,18 +3936,38 @@ void attractor::init(bool MOVIE_MODE)
 	transform_data();
     cerr << "done!\n";
     
-    cerr << "generating cross maps...";
-	generate_xmaps();
+    cerr << "generating cross maps and forecasts...";
+	generate_xmaps(ccm);
     cerr << "done!\n";
     
-    cerr << "generating forecasts...";
-    generate_forecasts();
-    cerr << "done!\n";
+    // core profile contexts draw through buffers and shaders only
+    render = create_renderer(matrices);
     
     cerr << "loading textures...";
     load_textures();
     cerr << "done!\n";
     
+    // vertex buffer objects are core since OpenGL 1.5
+    int gl_major = 0, gl_minor = 0;
+    const char* gl_version = (const char*) glGetString(GL_VERSION);
+    if(gl_version != NULL)
+        sscanf(gl_version, "%d.%d", &gl_major, &gl_minor);
+    VERTEX_BUFFERS = gl_major > 1 || (gl_major == 1 && gl_minor >= 5);
+    
+    // GLSL 1.20 needs OpenGL 2.1, older contexts color with the fixed-function pipeline
+    if(VERTEX_BUFFERS && (gl_major > 2 || (gl_major == 2 && gl_minor >= 1)))
+    {
+        load_shaders();
+    }
+    if(series_program != 0)
+        build_series_buffers();
+    
+    // framebuffer objects are core since OpenGL 3.0, whose core profile has no
+    // GL_EXTENSIONS string; the movie camera never stays still
+    const char* gl_extensions = gl_major >= 3 ? NULL : (const char*) glGetString(GL_EXTENSIONS);
+    TRAIL_BUFFERS = VERTEX_BUFFERS && !MOVIE_MODE &&
+                    (gl_major >= 3 || (gl_extensions != NULL && strstr(gl_extensions, "GL_ARB_framebuffer_object") != NULL));
+    
 	return;
 }
 
@@ -3024,31 +3982,31 @@ void attractor::reset_rot_matrix()
         case UNIVARIATE:
         case TIME_SERIES:
         case LAGS:
-			glMatrixMode(GL_PROJECTION);
-			glLoadIdentity();
-			gluPerspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
-			glMatrixMode(GL_MODELVIEW);
-			glLoadIdentity();
-			glRotated(-90, 1, 0, 0);
-            glGetDoublev(GL_MODELVIEW_MATRIX, rot_matrix);
+			matrices.mode(GL_PROJECTION);
+			matrices.load_identity();
+			matrices.perspective(30.0f,(GLfloat)window_width/(GLfloat)window_height,0.2f,10.0f);
+			matrices.mode(GL_MODELVIEW);
+			matrices.load_identity();
+			matrices.rotate(-90, 1, 0, 0);
+            matrices.get(GL_MODELVIEW, rot_matrix);
 			break;
         case XMAP:
         case XMAP_TS:
         case UNIVARIATE_TS:
-			glMatrixMode(GL_PROJECTION);
-			glLoadIdentity();
+			matrices.mode(GL_PROJECTION);
+			matrices.load_identity();
 			
 			if(0.75*window_width > window_height)
 			{
-				glOrtho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
+				matrices.ortho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
 			}
 			else
 			{
-				glOrtho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
+				matrices.ortho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
 			}
-			glMatrixMode(GL_MODELVIEW);
-			glLoadIdentity();
-            glGetDoublev(GL_MODELVIEW_MATRIX, rot_matrix);
+			matrices.mode(GL_MODELVIEW);
+			matrices.load_identity();
+            matrices.get(GL_MODELVIEW, rot_matrix);
 			break;
         default:
             break;
@@ -3067,21 +4025,15 @@ void attractor::rotate(const double rx, const double ry, const double rz)
 	else if(VIEW == MANIFOLD || VIEW == RECONSTRUCTION || VIEW == SHADOW || 
             VIEW == UNIVARIATE || VIEW == TIME_SERIES || VIEW == LAGS || VIEW == GENERIC_RECONSTRUCTION)
 	{
-		glGetDoublev(GL_MODELVIEW_MATRIX, rot_matrix);
-		glLoadIdentity();
-		glTranslated(-vx, -vy, -vz);
-		glRotated(rx, 1, 0, 0);
-		glTranslated(vx, vy, vz);
-		glMultMatrixd(rot_matrix);
-		
-		glGetDoublev(GL_MODELVIEW_MATRIX, rot_matrix);
-		glLoadIdentity();
-		glTranslated(-vx, -vy, -vz);
-		glRotated(ry, 0, 1, 0);
-		glTranslated(vx, vy, vz);
-		glMultMatrixd(rot_matrix);
-        
-        glGetDoublev(GL_MODELVIEW_MATRIX, rot_matrix);
+		// rx around x, then ry around y, both about (-vx, -vy, -vz)
+		double rotation[16];
+		quaternion q = quaternion::from_axis_angle(ry, 0, 1, 0) * quaternion::from_axis_angle(rx, 1, 0, 0);
+		q.to_matrix(rotation);
+		rotation[12] = rotation[0]*vx + rotation[4]*vy + rotation[8]*vz - vx;
+		rotation[13] = rotation[1]*vx + rotation[5]*vy + rotation[9]*vz - vy;
+		rotation[14] = rotation[2]*vx + rotation[6]*vy + rotation[10]*vz - vz;
+		multiply_matrix(rotation, matrices.top(GL_MODELVIEW), rot_matrix);
+		matrices.load(rot_matrix);
 	}
 	
 	return;
@@ -3091,10 +4043,14 @@ void attractor::translate(const double tx, const double ty, const double tz)
 {
 	double temp_matrix[16];
 	
-	glGetDoublev(GL_MODELVIEW_MATRIX, temp_matrix);
-    glLoadIdentity();
-    glTranslated(tx, ty, tz);
-    glMultMatrixd(temp_matrix);
+	matrices.get(GL_MODELVIEW, temp_matrix);
+	for(int j = 0; j < 4; j++)
+	{
+		temp_matrix[4*j] += tx * temp_matrix[4*j+3];
+		temp_matrix[4*j+1] += ty * temp_matrix[4*j+3];
+		temp_matrix[4*j+2] += tz * temp_matrix[4*j+3];
+	}
+	matrices.load(temp_matrix);
 	
 	return;
 }
@@ -3109,6 +4065,13 @@ void attractor::draw(double & runtime)
     double scale;
     texture_2d curr_texture;
     
+    // show the rebuilt cross maps once they are complete
+    swap_rebuild();
+    
+    // the modelview between frames is the camera moved by rotate() and translate()
+    matrices.push();
+    stats.begin_frame(VIEW);
+    
 	int frame;    
 	if(runtime > num_points)
 	{
@@ -3119,8 +4082,11 @@ void attractor::draw(double & runtime)
 		frame = int(runtime);
 	}
     texture_queue.clear();
+    curve_queue.clear();
+    update_skill(frame);
     
     // draw
+    stats.start(DRAW_VIEW);
 	switch(VIEW)
 	{
         case TAKENS:
@@ -3169,74 +4135,78 @@ void attractor::draw(double & runtime)
             curr_texture = my_textures[VIEW_7_LABEL_TEXTURE+lag_dim*2-2+(pred_dim > 6-lag_dim-pred_dim)];
 			break;
 	}
+    stats.stop(DRAW_VIEW);
 	
-    // draw texture labels
+    // draw markers, connecting curves and texture labels
+    draw_markers();
+    draw_curves();
     draw_labels();
     
     // set up ortho view for fixed location textures
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    matrices.mode(GL_PROJECTION);
+    matrices.load_identity();
     if(0.75*window_width > window_height)
     {
-        glOrtho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
+        matrices.ortho(-1.5*window_width/window_height, 1.5*window_width/window_height, -1.5, 1.5, -1.5, 1.5);
     }
     else
     {
-        glOrtho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
+        matrices.ortho(-2.0, 2.0, -2.0*window_height/window_width, 2.0*window_height/window_width, -1.5, 1.5);
     }
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    matrices.mode(GL_MODELVIEW);
+    matrices.load_identity();
     
     if(false) // draw slide titles
     {
-        glBindTexture(GL_TEXTURE_2D, curr_texture.texture_id);
-
-        glColor3d(1.0, 1.0, 1.0);
-        glEnable(GL_TEXTURE_2D);
-        glBegin(GL_QUADS);
-        glNormal3f(0.0, 0.0, 1.0);
-        glTexCoord2d(0.0, 0.0); glVertex3d(-curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
-        glTexCoord2d(0.0, 1.0); glVertex3d(-curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
-        glTexCoord2d(1.0, 1.0); glVertex3d(curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
-        glTexCoord2d(1.0, 0.0); glVertex3d(curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
-        glEnd();
-        glDisable(GL_TEXTURE_2D);
+        render->color(1.0, 1.0, 1.0);
+        render->texture(curr_texture.texture_id);
+        render->begin(GL_QUADS);
+        render->tex_coord(curr_texture.u0, curr_texture.v0); render->vertex(-curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->tex_coord(curr_texture.u0, curr_texture.v1); render->vertex(-curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->tex_coord(curr_texture.u1, curr_texture.v1); render->vertex(curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->tex_coord(curr_texture.u1, curr_texture.v0); render->vertex(curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->end();
+        render->texture(0);
     }
+    if(SKILL_HUD && (VIEW == UNIVARIATE || VIEW == UNIVARIATE_TS || VIEW == XMAP || VIEW == XMAP_TS))
+        draw_skill_hud();
+    if(stats.enabled())
+        draw_frame_stats_hud();
+    
     if (VIEW == MANIFOLD && DEBUG)
     {
         x_pos = 1.3;
         y_pos = 1.0;
         
         curr_texture = my_textures[EQUATIONS_LABEL_TEXTURE];
-        glBindTexture(GL_TEXTURE_2D, curr_texture.texture_id);
-        
-        glColor3d(1.0, 1.0, 1.0);
-        glEnable(GL_TEXTURE_2D);
-        glBegin(GL_QUADS);
-        glNormal3f(0.0, 0.0, 1.0);
-        glTexCoord2d(0.0, 0.0); glVertex3d(-curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
-        glTexCoord2d(0.0, 1.0); glVertex3d(-curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
-        glTexCoord2d(1.0, 1.0); glVertex3d(curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
-        glTexCoord2d(1.0, 0.0); glVertex3d(curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
-        glEnd();
-        glDisable(GL_TEXTURE_2D);
+        render->color(1.0, 1.0, 1.0);
+        render->texture(curr_texture.texture_id);
+        render->begin(GL_QUADS);
+        render->tex_coord(curr_texture.u0, curr_texture.v0); render->vertex(-curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->tex_coord(curr_texture.u0, curr_texture.v1); render->vertex(-curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->tex_coord(curr_texture.u1, curr_texture.v1); render->vertex(curr_texture.width/2.0*x_scale+x_pos, curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->tex_coord(curr_texture.u1, curr_texture.v0); render->vertex(curr_texture.width/2.0*x_scale+x_pos, -curr_texture.height/2.0*y_scale+y_pos, depth);
+        render->end();
+        render->texture(0);
         
         /*
-        glLineWidth(1.0);
-        glBegin(GL_LINES);
-        glColor3d(0.8, 0.8, 0.8);
-        glVertex2d(-1.5, -1.45);
-        glVertex2d(1.5, -1.45);
-        glColor4d(0.0, 0.0, 0.0, 1.0);
-        glVertex2d(-1.5, -1.4);
-        glVertex2d(-1.5, -1.5);
-        glVertex2d(1.5, -1.4);
-        glVertex2d(1.5, -1.5);
-        glVertex2d(-1.5, -1.45);
-        glVertex2d(3.0*double(frame)/double(num_points) - 1.5, -1.45);
-        glEnd();
+        render->line_width(1.0);
+        render->begin(GL_LINES);
+        render->color(0.8, 0.8, 0.8);
+        render->vertex(-1.5, -1.45);
+        render->vertex(1.5, -1.45);
+        render->color(0.0, 0.0, 0.0, 1.0);
+        render->vertex(-1.5, -1.4);
+        render->vertex(-1.5, -1.5);
+        render->vertex(1.5, -1.4);
+        render->vertex(1.5, -1.5);
+        render->vertex(-1.5, -1.45);
+        render->vertex(3.0*double(frame)/double(num_points) - 1.5, -1.45);
+        render->end();
         */
     }
+    matrices.pop();
+    stats.end_frame();
     
 	while(runtime > num_points)
 	{
@@ -3244,6 +4214,7 @@ void attractor::draw(double & runtime)
 		x_start_time = 0;
 		y_start_time = 0;
 		z_start_time = 0;
+        reset_skill();
 	}
 	
 	return;
@@ -3308,6 +4279,8 @@ void attractor::set_view(const int new_view)
     double persp_scale = 0.002;
     double ortho_scale = 0.0016;
     
+    clear_static_geometry();
+    clear_trails();
 	switch(new_view)
 	{
         case -1:
@@ -3436,6 +4409,7 @@ void attractor::set_view(const int new_view)
 
 void attractor::set_lagview(const int dim)
 {
+    clear_static_geometry();
 	lag_dim = dim;
 	if(lag_dim == pred_dim)
 	{
@@ -3498,6 +4472,23 @@ void attractor::inc_ytau()
     return;
 }
 
+void attractor::toggle_skill_hud()
+{
+    SKILL_HUD = !SKILL_HUD;
+    return;
+}
+
+void attractor::toggle_frame_stats()
+{
+    stats.toggle();
+    return;
+}
+
+bool attractor::write_frame_stats(const string filename) const
+{
+    return stats.write_csv(filename);
+}
+
 void attractor::toggle_split_view()
 {
     if(VIEW == GENERIC_RECONSTRUCTION)
@@ -3509,12 +4500,53 @@ void attractor::toggle_split_view()
 
 void attractor::change_tau(const int delta)
 {
-	tau += delta;
-	if(tau < 0)
-		tau = 0;
+    int old_tau = next_tau;
+    
+	next_tau += delta;
+	if(next_tau < 0)
+		next_tau = 0;
+    if(!next_parameters_fit())
+    {
+        next_tau = old_tau;
+        return;
+    }
+    start_rebuild();
 	return;
 }
 
+void attractor::change_nn_num(const int delta)
+{
+    int old_nn_num = next_nn_num;
+    
+    next_nn_num += delta;
+    if(next_nn_num < 1)
+        next_nn_num = 1;
+    if(!next_parameters_fit())
+    {
+        next_nn_num = old_nn_num;
+        return;
+    }
+    start_rebuild();
+    return;
+}
+
+void attractor::change_nn_skip(const int delta)
+{
+    int old_nn_skip = next_nn_skip;
+    
+    // at 1 the first candidate of a frame would be its own query point
+    next_nn_skip += delta;
+    if(next_nn_skip < 2)
+        next_nn_skip = 2;
+    if(!next_parameters_fit())
+    {
+        next_nn_skip = old_nn_skip;
+        return;
+    }
+    start_rebuild();
+    return;
+}
+
 void attractor::debug_toggle()
 {
     if(VIEW == LAGS)
@@ -3538,5 +4570,9 @@ void attractor::set_window_size(const int width, const int height)
 {
     window_width = width;
     window_height = height;
+    if(render != NULL)
+        render->set_viewport(width, height);
+    clear_static_geometry();
+    clear_trails();
     return;
 }
\ No newline at end of file
@@ -18,8 +18,15 @@
 #include <OpenGL/glu.h>
 #include <GLUT/glut.h>
 #include <math.h>
+#include <pthread.h>
 #include "/usr/X11/include/png.h"
 #include "CoreFoundation/CoreFoundation.h"
+#include "ccm.h"
+#include "grid_nn.h"
+#include "skill_stats.h"
+#include "frame_stats.h"
+#include "matrix_stack.h"
+#include "renderer.h"
 
 enum tracer {PROJECT, TRACE, NONE};
 enum draw_mode {MANIFOLD, TIME_SERIES, LAGS, 
@@ -43,12 +50,16 @@ enum ode_mode {EULER, RK4};
 #define EQUATIONS_LABEL_TEXTURE 38
 #define TAKENS_THEOREM_TEXTURE 39
 
+#define ATLAS_WIDTH 512   // labels before VIEW_1_LABEL_TEXTURE are packed in one texture
+#define ATLAS_PADDING 16  // alignment and spacing of the atlas, 2^ATLAS_MIPMAPS
+#define ATLAS_MIPMAPS 4
 
 struct texture_2d
 {
     GLuint texture_id;
     int width;
     int height;
+    double u0, v0, u1, v1; // part of the texture holding the image, [0, 1] unless in the atlas
 };
 
 struct texture_label
@@ -63,8 +74,87 @@ struct texture_label
 
 bool operator<(const texture_label & a, const texture_label & b);
 
+#define CURVE_SEGMENTS 50 // line segments per connecting curve
+#define STATIC_KEY_SIZE 8 // parameters identifying a piece of static geometry
+#define MAX_TRAILS 4      // accumulated trajectories kept, a window sized texture each
+
+#define LOD_BLOCK 256     // vertices simplified together, partial blocks are drawn in full
+#define LOD_LEVELS 8      // level l keeps the vertices needed for an error of LOD_MIN_ERROR * 2^l
+#define LOD_MIN_ERROR (1.0/2048)
+
+// vertex buffer of one embedding, vertex k is (series[0][k+lag[0]], series[1][k+lag[1]],
+// series[2][k+lag[2]]) followed by its grayscale color; the smallest lag is 0, so the
+// same buffer serves every shift of the embedding as a different first vertex
+struct embedding_buffer
+{
+    const double* series[3];
+    int lag[3];
+    GLuint buffer;
+    int num_vertices;
+    double box_min[3];
+    double box_max[3];
+    // Douglas-Peucker simplification of each block at every level; the vertices kept
+    // in block b at level l are index_buffer[block_offset[l][b] ... block_offset[l][b+1])
+    GLuint index_buffer;
+    vector<int> block_offset[LOD_LEVELS];
+};
+
+// display list of geometry that only changes with the view or the window size
+struct static_geometry
+{
+    double key[STATIC_KEY_SIZE];
+    GLuint list;
+    int num_vertices;
+};
+
+// trajectory drawn so far under a still camera, colors premultiplied by alpha
+struct trail_buffer
+{
+    GLuint buffer;     // embedding_buffer drawn
+    int first;
+    double line_width;
+    double matrix[16]; // projection * modelview
+    int frame;         // vertices accumulated, 0 until the camera stays still for a frame
+    int rect[4];       // window rectangle covering the embedding's bounding box, x, y, width, height
+    GLuint framebuffer;
+    GLuint texture;
+};
+
 using namespace std;
 
+// neighbor tables, cross maps and forecasts for one choice of embedding params
+struct ccm_data
+{
+    int tau;
+    int tp;
+    int nn_num;
+    int nn_skip;
+    vector<vector<int> > x_nn_indices;
+    vector<vector<double> > x_nn_weights;
+    vector<vector<int> > y_nn_indices;
+    vector<vector<double> > y_nn_weights;
+    vector<vector<int> > z_nn_indices;
+    vector<vector<double> > z_nn_weights;
+    vector<double> x_xmap_y;
+    vector<double> x_xmap_z;
+    vector<double> y_xmap_x;
+    vector<double> y_xmap_z;
+    vector<double> z_xmap_x;
+    vector<double> z_xmap_y;
+    vector<double> x_forecast;
+    vector<double> x_forecast_lag_1;
+    vector<double> x_forecast_lag_2;
+    vector<double> y_forecast;
+    vector<double> y_forecast_lag_1;
+    vector<double> y_forecast_lag_2;
+    vector<double> z_forecast;
+    vector<double> z_forecast_lag_1;
+    vector<double> z_forecast_lag_2;
+    
+    void resize(const int num_points);
+    void swap(ccm_data & other);
+};
+
 class attractor
 {
 public:
@@ -82,6 +172,7 @@ private:
     static const double LINE_WIDTH;
     static const double SMALL_LINE_WIDTH;
     static const double POINT_WIDTH;
+    static const double LOD_PIXEL_ERROR;
     
     static const double sigma;
     static const double rho;
@@ -96,6 +187,31 @@ private:
     // textures
     vector<texture_2d> my_textures;
     vector<texture_label> texture_queue;
+    vector<double> curve_queue; // 4 control points per connecting curve, in eye coordinates
+    vector<GLfloat> marker_queue; // 8 floats per marker: normalized device coordinates, rgba, diameter in pixels
+    double bezier_basis[CURVE_SEGMENTS+1][4];
+    
+    // trajectories uploaded to the GL, most recently created last
+    vector<embedding_buffer> embedding_buffers;
+    vector<GLfloat> embedding_colors; // per frame colors when they depend on the current point
+    GLuint embedding_program;         // colors trajectories on the GL, 0 if not supported
+    GLint current_point_location;
+    GLint color_method_location;
+    
+    // x, y, z as (sample, value) pairs, uploaded once in init(); the scrolling window of the
+    // time series panels is a draw range and a uniform offset
+    GLuint series_buffers[3];
+    GLuint series_program;            // 0 if not supported, the panels are then drawn vertex by vertex
+    GLint time_transform_location;
+    GLint fade_location;
+    GLint sat_location;
+    
+    // trajectories accumulated over frames, most recently used last
+    vector<trail_buffer> trails;
+    bool TRAIL_BUFFERS;
+    
+    // axes and time series frames, cleared by set_view, set_lagview and set_window_size
+    vector<static_geometry> static_geometry_cache;
     
 	// data
 	int num_points;
@@ -106,28 +222,7 @@ private:
     vector<double> phi_y;
     vector<double> phi_z;
     vector<int> knot;
-    int nn_num, nn_skip;
-    vector<vector<int> > x_nn_indices;
-    vector<vector<double> > x_nn_weights;
-    vector<vector<int> > y_nn_indices;
-    vector<vector<double> > y_nn_weights;
-    vector<vector<int> > z_nn_indices;
-    vector<vector<double> > z_nn_weights;
-    vector<double> x_xmap_y;
-    vector<double> x_xmap_z;
-    vector<double> y_xmap_x;
-    vector<double> y_xmap_z;
-    vector<double> z_xmap_x;
-    vector<double> z_xmap_y;
-    vector<double> x_forecast;
-    vector<double> x_forecast_lag_1;
-    vector<double> x_forecast_lag_2;
-    vector<double> y_forecast;
-    vector<double> y_forecast_lag_1;
-    vector<double> y_forecast_lag_2;
-    vector<double> z_forecast;
-    vector<double> z_forecast_lag_1;
-    vector<double> z_forecast_lag_2;
+    ccm_data ccm; // snapshot being displayed
 	
 	// params
 	int lag_dim;
@@ -146,15 +241,38 @@ private:
     int window_width;
     int window_height;
     double rot_matrix[16];
+    matrix_stack matrices; // modelview and projection, the GL only receives the results
+    renderer* render;      // every primitive goes through it, created in init()
+	
+    // background rebuild of ccm when tau, nn_num or nn_skip change
+    ccm_data ccm_back;
+    pthread_t rebuild_thread;
+    pthread_mutex_t rebuild_mutex;
+    bool rebuild_running;
+    bool rebuild_ready;
+    bool rebuild_cancel;
+    int next_tau;
+    int next_nn_num;
+    int next_nn_skip;
+    
+    // running skill of the displayed snapshot over frames [0, skill_frame)
+    running_skill forecast_skill[3];  // forecast of x, y, z from its own manifold
+    running_skill xmap_skill[3][3];   // [manifold][predicted variable]
+    int skill_frame;
 	
 	// switches
     ode_mode lorenz_sim_mode;
+    nn_backend nn_method;
+    bool MORTON_ORDER;
     bool DRAW_CONE;
 	int DEBUG;
     bool TSVIEW;
     bool COLOR_METHOD;
     bool MANIFOLD_LABEL;
     bool SPLIT_VIEW;
+    bool SKILL_HUD;
+    bool VERTEX_BUFFERS;
+    frame_stats stats; // timed and shown only while enabled
 	tracer x_tracer;
 	tracer y_tracer;
 	tracer z_tracer;
@@ -236,26 +354,59 @@ private:
                       const double sat, const double line_width);
 	void draw_ts(int frame, const int lag, const int skip, const int dim, 
                  const double sat, const double line_width);
-    void draw_embedding(vector<double>::iterator x_i, vector<double>::iterator y_i, vector<double>::iterator z_i, const int frame);
+    void draw_embedding(vector<double>::iterator x_i, vector<double>::iterator y_i, vector<double>::iterator z_i, const int frame,
+                        const double line_width);
+    const embedding_buffer & find_embedding_buffer(const double* series[3], const int lag[3]);
+    void build_embedding_lod(embedding_buffer & b, const vector<GLfloat> & vertices);
+    void draw_embedding_range(const embedding_buffer & b, const int first, const int count);
+    void build_series_buffers();
+    void draw_series(const int dim, const int first, const int count, const int stride, const double time_scale,
+                     const double time_offset, const bool fade, const double sat);
+    const trail_buffer* draw_embedding_trail(const embedding_buffer & b, const int first, const int count,
+                                             const double line_width);
+    void composite_trail(const trail_buffer & trail);
+    void clear_trails();
 	void draw_tracers(const int frame);
 	void draw_axes(bool lag, int lag_dim);
     void draw_lag_axis(int direction, int dim, int lag);
     void draw_axis(const int axis, const double r, const double g, const double b, 
                    const double delta_line_width, const int texture_index, const int lag);
+    void draw_cone(const double base, const double height, const int slices, const double* m);
+    bool call_static_geometry(const double* key);
+    void end_static_geometry(const int num_vertices);
+    void clear_static_geometry();
     void draw_labels();
+    void update_skill(const int frame);
+    void reset_skill();
+    void draw_skill_hud();
+    void draw_frame_stats_hud();
     void enqueue_label(double pos_x, double pos_y, double pos_z, int texture_index, double scale, int x_peg, int y_peg);
     void draw_curve(const double x1, const double y1, const double z1, 
                     const double x2, const double y2, const double z2);
+    void draw_curves();
+    void enqueue_marker(const double x, const double y, const double z, const double* rgba, const double size);
+    void enqueue_marker(const double x, const double y, const double z,
+                        const double r, const double g, const double b, const double a, const double size);
+    void draw_markers();
     void col(const double x, const double y, const double z);
     double N(const int i, const int k, const double u);
     void generate_movie();
     void generate_data();
 	void transform_data();
-    void generate_xmaps();
-    void generate_forecasts();
+    void generate_xmaps(ccm_data & data);
+    void generate_predictions(ccm_data & data);
     void load_textures();
     GLuint load_texture(const string filename, int &width, int &height);
-    void find_neighbors(const int dim);
+    GLuint make_texture(const png_byte* image_data, const int width, const int height);
+    bool read_png(const string filename, int &width, int &height, vector<png_byte> & image);
+    void load_shaders();
+    void find_neighbors(ccm_data & data, const int dim);
+    static void* rebuild_worker(void* arg);
+    bool next_parameters_fit();
+    void start_rebuild();
+    void stop_rebuild();
+    void swap_rebuild();
+    bool rebuild_cancelled();
     
 public:
 	void init(bool MOVIE_MODE);
@@ -278,10 +429,18 @@ public:
     void inc_xtau();
     void inc_ytau();
     void toggle_split_view();
+    void toggle_skill_hud();
+    void toggle_frame_stats();
+    bool write_frame_stats(const string filename) const;
 	void change_tau(const int delta);
+    void change_nn_num(const int delta);
+    void change_nn_skip(const int delta);
 	void debug_toggle();
 	void change_scale(const double new_scale);
     void set_window_size(const int width, const int height);
+    // a background rebuild runs or waits for draw() to show it; finished once it waits
+    bool rebuilding() const {return rebuild_running;}
+    bool rebuild_finished();
 	
 };
 
@@ -0,0 +1,667 @@
+/*
+ *  ccm.cpp
+ *  LorenzGL_verHY
+ *
+ *  Offline convergent cross mapping on lagged embeddings of many series.
+ *
+ */
+
+#include "ccm.h"
+#include "parallel.h"
+#include "grid_nn.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <sys/time.h>
+
+bool load_series(const string filename, vector<vector<double> > & series)
+{
+    ifstream in(filename.c_str());
+    string line;
+    vector<double> row;
+    char* end;
+    int line_num = 0;
+
+    series.clear();
+    if(!in)
+    {
+        cerr << "ERROR (ccm): unable to open " << filename << ".\n";
+        return false;
+    }
+
+    while(getline(in, line))
+    {
+        line_num++;
+        for(int i = 0; i < line.size(); i++)
+        {
+            if(line[i] == ',' || line[i] == ';')
+                line[i] = ' ';
+        }
+
+        // parse row
+        row.clear();
+        istringstream tokens(line);
+        string token;
+        bool numeric = true;
+        while(tokens >> token)
+        {
+            double value = strtod(token.c_str(), &end);
+            if(*end != '\0')
+            {
+                numeric = false;
+                break;
+            }
+            row.push_back(value);
+        }
+
+        // skip blank lines and column headers
+        if(!numeric || row.size() == 0)
+            continue;
+
+        if(series.size() == 0)
+            series.resize(row.size());
+        if(row.size() != series.size())
+        {
+            cerr << "ERROR (ccm): " << filename << ":" << line_num << " has " << row.size()
+                 << " columns, expected " << series.size() << ".\n";
+            series.clear();
+            return false;
+        }
+        for(int i = 0; i < row.size(); i++)
+            series[i].push_back(row[i]);
+    }
+    return series.size() > 0;
+}
+
+static void simplex_weights(const double* sq_distances, const int nn_num, double* weights)
+{
+    double d0 = sqrt(sq_distances[0]);
+    double total_weight = 0;
+
+    for(int i = 0; i < nn_num; i++)
+    {
+        double d = sqrt(sq_distances[i]);
+        if(d0 > 0)
+            weights[i] = exp(-d / d0);
+        else
+            weights[i] = (d == 0) ? 1.0 : 0.0;
+        if(weights[i] < 0.00001)
+            weights[i] = 0.00001;
+        total_weight += weights[i];
+    }
+    for(int i = 0; i < nn_num; i++)
+        weights[i] /= total_weight;
+    return;
+}
+
+nn_grid::nn_grid(const vector<const double*> & cols, const int n, const int start, const int nn_skip)
+{
+    const double* axes[3];
+    double lo = 0, hi = 0;
+
+    grid = NULL;
+    if(n <= start)
+        return;
+    zeros.assign(n - start, 0.0);
+    for(int e = 0; e < 3; e++)
+        axes[e] = e < cols.size() ? cols[e] : &zeros[0];
+    lo = hi = axes[0][0];
+    for(int e = 0; e < 3; e++)
+    {
+        for(int p = 0; p < n - start; p++)
+        {
+            if(axes[e][p] < lo)
+                lo = axes[e][p];
+            else if(axes[e][p] > hi)
+                hi = axes[e][p];
+        }
+    }
+    grid = new grid_nn(axes[0], axes[1], axes[2], n - start, lo, hi, nn_skip);
+}
+
+nn_grid::~nn_grid()
+{
+    delete grid;
+}
+
+static void search_nn_table(const vector<const double*> & cols, const int n, const int start,
+                            const int nn_num, const int nn_skip, nn_table & table,
+                            const nn_grid* grid, const int theiler, const bool spatial_order)
+{
+    const int E = cols.size();
+    int min_step = (theiler / nn_skip + 1) * nn_skip; // closest allowed t - s
+    vector<double> nn_distances(nn_num), query(max(E-3, 0));
+    double temp_distance, diff;
+    int count, rank;
+
+    table.num_points = n;
+    table.nn_num = nn_num;
+    table.first = start + min_step + (nn_num-1)*nn_skip;
+    table.indices.assign(n*nn_num, -1);
+    table.weights.assign(n*nn_num, 0.0);
+    if(n <= start)
+        grid = NULL;
+
+    // neighboring rows share most of their candidate cells
+    table.order.clear();
+    if(grid && spatial_order)
+    {
+        const vector<int> & points = grid->get().spatial_order();
+        for(int e = 0; e < points.size(); e++)
+        {
+            if(points[e] + start >= table.first)
+                table.order.push_back(points[e] + start);
+        }
+    }
+    else
+    {
+        for(int t = table.first; t < n; t++)
+            table.order.push_back(t);
+    }
+
+    for(int row = 0; row < table.order.size(); row++)
+    {
+        int t = table.order[row];
+        int p = t - start;
+        int* nn_indices = &table.indices[t*nn_num];
+
+        if(grid)
+        {
+            // coordinates an embedding does not have are zero on the grid, the ones
+            // after the third are compared point by point
+            for(int e = 3; e < E; e++)
+                query[e-3] = cols[e][p];
+            grid->get().query(cols[0][p], E > 1 ? cols[1][p] : 0.0, E > 2 ? cols[2][p] : 0.0, p - min_step,
+                              nn_num, nn_indices, &nn_distances[0],
+                              E-3, E > 3 ? &cols[3] : NULL, E > 3 ? &query[0] : NULL);
+            for(int i = 0; i < nn_num; i++)
+                nn_indices[i] += start;
+        }
+        else
+        {
+            // keep the nn_num closest candidates sorted by distance
+            count = 0;
+            for(int q = p - min_step; q >= 0; q -= nn_skip)
+            {
+                temp_distance = 0;
+                for(int e = 0; e < E; e++)
+                {
+                    diff = cols[e][p] - cols[e][q];
+                    temp_distance += diff*diff;
+                }
+
+                if(count < nn_num)
+                    rank = count++;
+                else if(temp_distance < nn_distances[nn_num-1])
+                    rank = nn_num-1;
+                else
+                    continue;
+
+                for(; rank > 0 && nn_distances[rank-1] > temp_distance; rank--)
+                {
+                    nn_distances[rank] = nn_distances[rank-1];
+                    nn_indices[rank] = nn_indices[rank-1];
+                }
+                nn_distances[rank] = temp_distance;
+                nn_indices[rank] = q + start;
+            }
+        }
+
+        simplex_weights(&nn_distances[0], nn_num, &table.weights[t*nn_num]);
+    }
+    return;
+}
+
+void build_nn_table(const vector<const double*> & cols, const int n, const int start,
+                    const int nn_num, const int nn_skip, nn_table & table,
+                    const int theiler, const nn_backend backend, const bool spatial_order)
+{
+    if(n > start && backend != NN_BRUTE)
+    {
+        nn_grid grid(cols, n, start, nn_skip);
+        search_nn_table(cols, n, start, nn_num, nn_skip, table, &grid, theiler, spatial_order);
+    }
+    else
+        search_nn_table(cols, n, start, nn_num, nn_skip, table, NULL, theiler, spatial_order);
+    return;
+}
+
+void build_nn_table(const vector<const double*> & cols, const int n, const int start,
+                    const int nn_num, const int nn_skip, nn_table & table, const nn_grid & grid,
+                    const int theiler, const bool spatial_order)
+{
+    search_nn_table(cols, n, start, nn_num, nn_skip, table, &grid, theiler, spatial_order);
+    return;
+}
+
+void build_nn_table(const vector<double> & ts, const int E, const int tau,
+                    const int nn_num, const int nn_skip, nn_table & table,
+                    const int theiler, const nn_backend backend, const bool spatial_order)
+{
+    int n = ts.size();
+    int start = (E-1)*tau;
+    vector<const double*> cols(E);
+
+    if(n <= start)
+    {
+        table.num_points = n;
+        table.nn_num = nn_num;
+        table.first = n;
+        table.indices.assign(n*nn_num, -1);
+        table.weights.assign(n*nn_num, 0.0);
+        table.order.clear();
+        return;
+    }
+
+    // coordinate e of point p is ts[p + start - e*tau]
+    for(int e = 0; e < E; e++)
+        cols[e] = &ts[start - e*tau];
+    build_nn_table(cols, n, start, nn_num, nn_skip, table, theiler, backend, spatial_order);
+    return;
+}
+
+// with leave-one-out every point farther than theiler steps is a candidate; with
+// k-fold the points of a block and theiler steps around it are left out
+static inline bool cv_allowed(const int t, const int s, const int theiler, const int num_folds,
+                              const vector<int> & fold_first, const vector<int> & fold_of)
+{
+    if(num_folds <= 1)
+        return s - t > theiler || t - s > theiler;
+    int f = fold_of[t];
+    return s < fold_first[f] - theiler || s >= fold_first[f+1] + theiler;
+}
+
+// keep the nn_num closest candidates sorted by distance
+static inline void cv_insert(const int s, const double dd, const int nn_num, int & count,
+                             int* nn_indices, double* nn_distances)
+{
+    int rank;
+
+    if(count < nn_num)
+        rank = count++;
+    else if(dd < nn_distances[nn_num-1])
+        rank = nn_num-1;
+    else
+        return;
+    for(; rank > 0 && nn_distances[rank-1] > dd; rank--)
+    {
+        nn_distances[rank] = nn_distances[rank-1];
+        nn_indices[rank] = nn_indices[rank-1];
+    }
+    nn_distances[rank] = dd;
+    nn_indices[rank] = s;
+    return;
+}
+
+void build_nn_table_cv(const vector<double> & ts, const int E, const int tau, const int nn_num,
+                       const int max_tp, nn_table & table, const int theiler, const int num_folds)
+{
+    const int TILE = 256;
+    int n = ts.size();
+    int start = (E-1)*tau;
+    int num = n - start;
+    int last_library = n - 1 - max_tp; // library points need max_tp future values
+    vector<double> points, nn_distances;
+    vector<int> counts, fold_first, fold_of;
+    double dd, diff;
+
+    table.num_points = n;
+    table.nn_num = nn_num;
+    table.first = start;
+    table.indices.assign(n*nn_num, -1);
+    table.weights.assign(n*nn_num, 0.0);
+    table.order.clear();
+    if(num <= 0)
+    {
+        table.first = n;
+        return;
+    }
+
+    // blocks of consecutive rows
+    if(num_folds > 1)
+    {
+        fold_of.resize(n, 0);
+        for(int f = 0; f <= num_folds; f++)
+            fold_first.push_back(start + int((long long)num * f / num_folds));
+        for(int f = 0; f < num_folds; f++)
+        {
+            for(int t = fold_first[f]; t < fold_first[f+1]; t++)
+                fold_of[t] = f;
+        }
+    }
+
+    // packed coordinates, point p is row p + start
+    points.resize(num*E);
+    for(int p = 0; p < num; p++)
+    {
+        for(int e = 0; e < E; e++)
+            points[p*E + e] = ts[p + start - e*tau];
+    }
+
+    // every pair is measured once and offered to both of its points, in tiles so
+    // both blocks of points and their neighbor lists stay in cache
+    nn_distances.assign(n*nn_num, HUGE_VAL);
+    counts.assign(n, 0);
+    for(int p0 = 0; p0 < num; p0 += TILE)
+    {
+        int p1 = min(p0 + TILE, num);
+        for(int q0 = p0; q0 < num; q0 += TILE)
+        {
+            int q1 = min(q0 + TILE, num);
+            for(int p = p0; p < p1; p++)
+            {
+                const int t = p + start;
+                const double* a = &points[p*E];
+                for(int q = max(q0, p+1); q < q1; q++)
+                {
+                    const int s = q + start;
+                    bool s_for_t = s <= last_library && cv_allowed(t, s, theiler, num_folds, fold_first, fold_of);
+                    bool t_for_s = t <= last_library && cv_allowed(s, t, theiler, num_folds, fold_first, fold_of);
+                    if(!s_for_t && !t_for_s)
+                        continue;
+
+                    const double* b = &points[q*E];
+                    dd = 0;
+                    for(int e = 0; e < E; e++)
+                    {
+                        diff = a[e] - b[e];
+                        dd += diff*diff;
+                    }
+                    if(s_for_t)
+                        cv_insert(s, dd, nn_num, counts[t], &table.indices[t*nn_num], &nn_distances[t*nn_num]);
+                    if(t_for_s)
+                        cv_insert(t, dd, nn_num, counts[s], &table.indices[s*nn_num], &nn_distances[s*nn_num]);
+                }
+            }
+        }
+    }
+
+    for(int t = start; t < n; t++)
+    {
+        if(counts[t] < nn_num)
+        {
+            cerr << "ERROR (ccm): too few library points for cross validation, " << counts[t]
+                 << " of " << nn_num << " neighbors at t = " << t << ".\n";
+            exit(1);
+        }
+        simplex_weights(&nn_distances[t*nn_num], nn_num, &table.weights[t*nn_num]);
+        table.order.push_back(t);
+    }
+    return;
+}
+
+void xmap(const nn_table & table, const vector<double> & target, vector<double> & pred)
+{
+    const int k = table.nn_num;
+
+    for(int t = 0; t < table.first; t++)
+        pred[t] = 0;
+    for(int row = 0; row < table.order.size(); row++)
+    {
+        const int t = table.order[row];
+        const int* nn_indices = &table.indices[t*k];
+        const double* nn_weights = &table.weights[t*k];
+        double p = 0;
+        for(int i = 0; i < k; i++)
+            p += target[nn_indices[i]] * nn_weights[i];
+        pred[t] = p;
+    }
+    return;
+}
+
+void forecast_horizons(const nn_table & table, const vector<double> & ts, const int max_tp,
+                       vector<vector<double> > & pred)
+{
+    const int k = table.nn_num;
+    const int n = table.num_points;
+    vector<double> acc(max_tp);
+    int horizons;
+
+    pred.resize(max_tp);
+    for(int h = 0; h < max_tp; h++)
+        pred[h].assign(n, 0);
+
+    for(int row = 0; row < table.order.size(); row++)
+    {
+        const int t = table.order[row];
+        const int* nn_indices = &table.indices[t*k];
+        const double* nn_weights = &table.weights[t*k];
+
+        // causal neighbors are older than t, so their futures exist wherever t+tp
+        // does; cross validated tables only use points with max_tp future values
+        horizons = min(max_tp, n-1 - t);
+        if(horizons < 1)
+            continue;
+        for(int h = 0; h < horizons; h++)
+            acc[h] = 0;
+        for(int i = 0; i < k; i++)
+        {
+            const double w = nn_weights[i];
+            const double* future = &ts[nn_indices[i] + 1];
+            for(int h = 0; h < horizons; h++)
+                acc[h] += w * future[h];
+        }
+        for(int h = 0; h < horizons; h++)
+            pred[h][t+h+1] = acc[h];
+    }
+    return;
+}
+
+struct forecast_job
+{
+    const vector<vector<double> >* series;
+    int E, tau, nn_num, nn_skip, max_tp;
+    bool cross_validate;
+    int theiler, num_folds;
+    vector<vector<double> >* rho;
+};
+
+static void forecast_series(const int var, void* arg)
+{
+    forecast_job* job = (forecast_job*) arg;
+    const vector<double> & ts = (*job->series)[var];
+    nn_table table;
+    vector<vector<double> > pred;
+
+    if(job->cross_validate)
+        build_nn_table_cv(ts, job->E, job->tau, job->nn_num, job->max_tp, table, job->theiler, job->num_folds);
+    else
+        build_nn_table(ts, job->E, job->tau, job->nn_num, job->nn_skip, table);
+    forecast_horizons(table, ts, job->max_tp, pred);
+    (*job->rho)[var].resize(job->max_tp);
+    for(int h = 0; h < job->max_tp; h++)
+        (*job->rho)[var][h] = pearson(pred[h], ts, table.first + h+1, table.num_points);
+    return;
+}
+
+void forecast_curves(const vector<vector<double> > & series, const int E, const int tau,
+                     const int nn_num, const int nn_skip, const int max_tp,
+                     vector<vector<double> > & rho, const int num_threads)
+{
+    forecast_job job;
+
+    job.series = &series;
+    job.E = E;
+    job.tau = tau;
+    job.nn_num = nn_num;
+    job.nn_skip = nn_skip;
+    job.max_tp = max_tp;
+    job.cross_validate = false;
+    job.rho = &rho;
+    rho.resize(series.size());
+    parallel_for(series.size(), forecast_series, &job, num_threads);
+    return;
+}
+
+void cv_forecast_curves(const vector<vector<double> > & series, const int E, const int tau,
+                        const int nn_num, const int theiler, const int num_folds, const int max_tp,
+                        vector<vector<double> > & rho, const int num_threads)
+{
+    forecast_job job;
+
+    job.series = &series;
+    job.E = E;
+    job.tau = tau;
+    job.nn_num = nn_num;
+    job.nn_skip = 1;
+    job.max_tp = max_tp;
+    job.cross_validate = true;
+    job.theiler = theiler;
+    job.num_folds = num_folds;
+    job.rho = &rho;
+    rho.resize(series.size());
+    parallel_for(series.size(), forecast_series, &job, num_threads);
+    return;
+}
+
+double pearson(const vector<double> & a, const vector<double> & b, const int first, const int last)
+{
+    double mean_a = 0, mean_b = 0;
+    double cov = 0, var_a = 0, var_b = 0;
+    int n = last - first;
+
+    if(n < 2)
+        return 0;
+    for(int i = first; i < last; i++)
+    {
+        mean_a += a[i];
+        mean_b += b[i];
+    }
+    mean_a /= n;
+    mean_b /= n;
+    for(int i = first; i < last; i++)
+    {
+        cov += (a[i] - mean_a) * (b[i] - mean_b);
+        var_a += (a[i] - mean_a) * (a[i] - mean_a);
+        var_b += (b[i] - mean_b) * (b[i] - mean_b);
+    }
+    if(var_a <= 0 || var_b <= 0)
+        return 0;
+    return cov / sqrt(var_a * var_b);
+}
+
+xmap_matrix::xmap_matrix(const vector<vector<double> > & series, const int E, const int tau,
+                         const int nn_num, const int nn_skip) : series(series)
+{
+    num_vars = series.size();
+    this->E = E;
+    this->tau = tau;
+    this->nn_num = nn_num;
+    this->nn_skip = nn_skip;
+    skill.resize(num_vars * num_vars, 0);
+}
+
+void xmap_matrix::compute_library(const int lib, void* arg)
+{
+    xmap_matrix* m = (xmap_matrix*) arg;
+    const vector<double> & ts = m->series[lib];
+    nn_table table;
+    vector<double> pred(ts.size());
+
+    // one neighbor search per library, shared by all targets
+    build_nn_table(ts, m->E, m->tau, m->nn_num, m->nn_skip, table);
+    for(int target = 0; target < m->num_vars; target++)
+    {
+        xmap(table, m->series[target], pred);
+        m->skill[lib * m->num_vars + target] = pearson(pred, m->series[target], table.first, table.num_points);
+    }
+    return;
+}
+
+void xmap_matrix::compute(const int num_threads)
+{
+    for(int i = 1; i < num_vars; i++)
+    {
+        if(series[i].size() != series[0].size())
+        {
+            cerr << "ERROR (xmap_matrix): series " << i << " has " << series[i].size()
+                 << " points, expected " << series[0].size() << ".\n";
+            exit(1);
+        }
+    }
+    parallel_for(num_vars, compute_library, this, num_threads);
+    return;
+}
+
+void xmap_matrix::write(ostream & out) const
+{
+    for(int lib = 0; lib < num_vars; lib++)
+    {
+        for(int target = 0; target < num_vars; target++)
+        {
+            if(target > 0)
+                out << ",";
+            out << get_skill(lib, target);
+        }
+        out << "\n";
+    }
+    return;
+}
+
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+void nn_benchmark(ostream & out, const int max_n, const int nn_num, const int nn_skip, const int theiler)
+{
+    const int E = 3, tau = 7;
+    const double dt = 0.01;
+    double x = 20, y = 20, z = 20, xx, yy, zz;
+    double t0, grid_time, time_order_time, brute_time;
+    vector<double> ts;
+    nn_table grid_table, time_order_table, brute_table;
+    int mismatches, brute_n = 1;
+    double brute_n_time = 0;
+
+    out << "n,grid_seconds,grid_time_order_seconds,brute_seconds,brute_extrapolated,mismatches\n";
+    for(int n = 1000; n <= max_n; n *= 10)
+    {
+        // Lorenz x, same system and step as attractor::EULER_sim
+        ts.resize(n);
+        x = 20;
+        y = 20;
+        z = 20;
+        for(int i = 0; i < n; i++)
+        {
+            ts[i] = x;
+            xx = x;
+            yy = y;
+            zz = z;
+            x = xx + 10 * (yy - xx) * dt;
+            y = yy + (28 * xx - xx * zz - yy) * dt;
+            z = zz + (xx * yy - 8.0/3 * zz) * dt;
+        }
+
+        t0 = wall_time();
+        build_nn_table(ts, E, tau, nn_num, nn_skip, grid_table, theiler, NN_GRID);
+        grid_time = wall_time() - t0;
+        t0 = wall_time();
+        build_nn_table(ts, E, tau, nn_num, nn_skip, time_order_table, theiler, NN_GRID, false);
+        time_order_time = wall_time() - t0;
+        time_order_table = nn_table();
+
+        // brute force is quadratic, so past 10^5 points scale the last measured run
+        if(n <= 100000)
+        {
+            t0 = wall_time();
+            build_nn_table(ts, E, tau, nn_num, nn_skip, brute_table, theiler, NN_BRUTE);
+            brute_time = wall_time() - t0;
+            mismatches = 0;
+            for(int i = 0; i < n*nn_num; i++)
+                mismatches += grid_table.indices[i] != brute_table.indices[i];
+            brute_n = n;
+            brute_n_time = brute_time;
+            out << n << "," << grid_time << "," << time_order_time << "," << brute_time << ",0," << mismatches << "\n";
+        }
+        else
+        {
+            brute_time = brute_n_time * (double(n) / brute_n) * (double(n) / brute_n);
+            out << n << "," << grid_time << "," << time_order_time << "," << brute_time << ",1,-\n";
+        }
+        out.flush();
+    }
+    return;
+}
@@ -0,0 +1,137 @@
+/*
+ *  ccm.h
+ *  LorenzGL_verHY
+ *
+ *  Offline convergent cross mapping on lagged embeddings of many series.
+ *
+ */
+#ifndef CCM_H
+#define CCM_H
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <math.h>
+
+using namespace std;
+
+// how neighbor tables are searched; NN_GRID and NN_AUTO use a grid over the first three
+// coordinates, the others of higher dimensional embeddings only add to its distances
+enum nn_backend {NN_BRUTE, NN_GRID, NN_AUTO};
+
+class grid_nn;
+
+// the grid over the first three coordinates of the points p = t - start, 0 <= p < n - start,
+// zero for the ones an embedding of E < 3 does not have; embeddings that have these
+// coordinates in common can share one
+class nn_grid
+{
+public:
+    nn_grid(const vector<const double*> & cols, const int n, const int start, const int nn_skip);
+    ~nn_grid();
+
+    const grid_nn & get() const {return *grid;}
+
+private:
+    nn_grid(const nn_grid &);
+    nn_grid & operator=(const nn_grid &);
+
+    grid_nn* grid;
+    vector<double> zeros;
+};
+
+// nearest neighbors of every point of one shadow manifold, stored row-major:
+// row t holds the nn_num neighbors of the point whose newest coordinate is ts[t]
+struct nn_table
+{
+    int num_points;
+    int nn_num;
+    int first; // first row with neighbors
+    vector<int> indices;
+    vector<double> weights; // normalized to sum to 1 in each row
+    vector<int> order;      // rows first ... num_points-1 in the order they were searched
+};
+
+// read whitespace or comma separated columns, one variable per column
+bool load_series(const string filename, vector<vector<double> > & series);
+
+// causal simplex neighbors of the points p = t - start, 0 <= p < n - start, with
+// coordinates cols[0][p] ... cols[E-1][p]; neighbors and rows are stored by t
+void build_nn_table(const vector<const double*> & cols, const int n, const int start,
+                    const int nn_num, const int nn_skip, nn_table & table,
+                    const int theiler = 0, const nn_backend backend = NN_AUTO,
+                    const bool spatial_order = true);
+
+// same with a grid built for n, start, nn_skip and the first three of cols
+void build_nn_table(const vector<const double*> & cols, const int n, const int start,
+                    const int nn_num, const int nn_skip, nn_table & table, const nn_grid & grid,
+                    const int theiler = 0, const bool spatial_order = true);
+
+// causal simplex neighbors in the E-dimensional lagged embedding of ts: the
+// candidates for time t are t - nn_skip, t - 2*nn_skip, ... (same rule as attractor::find_neighbors)
+// that are more than theiler steps away from t; with spatial_order the grid backend
+// searches the rows in Morton order of their points instead of in time order
+void build_nn_table(const vector<double> & ts, const int E, const int tau,
+                    const int nn_num, const int nn_skip, nn_table & table,
+                    const int theiler = 0, const nn_backend backend = NN_AUTO,
+                    const bool spatial_order = true);
+
+// non-causal neighbors for offline skill: leave-one-out (every s with |t - s| > theiler)
+// when num_folds <= 1, otherwise blocked k-fold (s more than theiler steps outside the
+// block of t); only points with max_tp future values are used as neighbors
+void build_nn_table_cv(const vector<double> & ts, const int E, const int tau, const int nn_num,
+                       const int max_tp, nn_table & table, const int theiler, const int num_folds = 0);
+
+// estimate target from the neighbors in table, pred must have table.num_points entries
+void xmap(const nn_table & table, const vector<double> & target, vector<double> & pred);
+
+// simplex forecasts of ts[t+tp] for tp = 1 ... max_tp from the neighbors of row t,
+// all horizons in one pass over the table; pred[tp-1][t+tp], 0 where undefined
+void forecast_horizons(const nn_table & table, const vector<double> & ts, const int max_tp,
+                       vector<vector<double> > & pred);
+
+// forecast skill of every series from its own shadow manifold, rho[var][tp-1]
+void forecast_curves(const vector<vector<double> > & series, const int E, const int tau,
+                     const int nn_num, const int nn_skip, const int max_tp,
+                     vector<vector<double> > & rho, const int num_threads = 0);
+
+// same with cross validated neighbors instead of causal ones
+void cv_forecast_curves(const vector<vector<double> > & series, const int E, const int tau,
+                        const int nn_num, const int theiler, const int num_folds, const int max_tp,
+                        vector<vector<double> > & rho, const int num_threads = 0);
+
+// Pearson correlation of a and b over [first, last)
+double pearson(const vector<double> & a, const vector<double> & b, const int first, const int last);
+
+// time the grid and brute force backends on Lorenz data of 10^3 ... max_n points
+void nn_benchmark(ostream & out, const int max_n, const int nn_num, const int nn_skip, const int theiler);
+
+// cross map skill of every variable from the shadow manifold of every other variable
+class xmap_matrix
+{
+public:
+    xmap_matrix(const vector<vector<double> > & series, const int E, const int tau,
+                const int nn_num, const int nn_skip);
+
+    void compute(const int num_threads = 0);
+
+    // rho of predicting target from the manifold of lib ("lib xmap target")
+    double get_skill(const int lib, const int target) const {return skill[lib * num_vars + target];}
+    int size() const {return num_vars;}
+    void write(ostream & out) const;
+
+private:
+    static void compute_library(const int lib, void* arg);
+
+    const vector<vector<double> > & series;
+    int num_vars;
+    int E;
+    int tau;
+    int nn_num;
+    int nn_skip;
+    vector<double> skill;
+};
+
+#endif
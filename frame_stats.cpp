@@ -0,0 +1,110 @@
+/*
+ *  frame_stats.cpp
+ *  LorenzGL_verHY
+ *
+ *  Time and submission counts of every drawn frame, broken down by draw routine.
+ *
+ */
+
+#include "frame_stats.h"
+#include <algorithm>
+#include <fstream>
+#include <sys/time.h>
+
+static const char* routine_names[NUM_DRAW_ROUTINES] = {"frame", "view", "embedding", "time_series",
+                                                       "tracers", "axes", "markers", "curves", "labels", "hud"};
+
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+const char* draw_routine_name(const draw_routine r)
+{
+    return routine_names[r];
+}
+
+frame_stats::frame_stats()
+{
+    on = false;
+    num_frames = 0;
+    recent.resize(FRAME_STATS_WINDOW);
+    fill(depth, depth + NUM_DRAW_ROUTINES, 0);
+}
+
+void frame_stats::begin_frame(const int view)
+{
+    current.view = view;
+    fill(current.time, current.time + NUM_DRAW_ROUTINES, 0.0);
+    current.draw_calls = 0;
+    current.vertices = 0;
+    current.labels = 0;
+    current.texture_binds = 0;
+    start(DRAW_FRAME);
+    return;
+}
+
+void frame_stats::end_frame()
+{
+    stop(DRAW_FRAME);
+    if(!on)
+        return;
+    recent[num_frames % FRAME_STATS_WINDOW] = current;
+    history.push_back(current);
+    num_frames++;
+    return;
+}
+
+void frame_stats::start(const draw_routine r)
+{
+    if(on && depth[r]++ == 0)
+        start_time[r] = wall_time();
+    return;
+}
+
+void frame_stats::stop(const draw_routine r)
+{
+    if(on && depth[r] > 0 && --depth[r] == 0)
+        current.time[r] += 1000 * (wall_time() - start_time[r]);
+    return;
+}
+
+double frame_stats::percentile(const draw_routine r, const double p, const int view) const
+{
+    vector<double> times;
+    int k;
+    
+    for(int i = 0; i < min(num_frames, FRAME_STATS_WINDOW); i++)
+    {
+        if(recent[i].view == view)
+            times.push_back(recent[i].time[r]);
+    }
+    if(times.empty())
+        return 0;
+    k = int(p / 100 * (times.size()-1) + 0.5);
+    nth_element(times.begin(), times.begin() + k, times.end());
+    return times[k];
+}
+
+bool frame_stats::write_csv(const string filename) const
+{
+    ofstream out(filename.c_str());
+    
+    if(!out)
+        return false;
+    out << "frame,view";
+    for(int r = 0; r < NUM_DRAW_ROUTINES; r++)
+        out << "," << routine_names[r] << "_ms";
+    out << ",draw_calls,vertices,labels,texture_binds\n";
+    for(int i = 0; i < history.size(); i++)
+    {
+        const frame_sample & s = history[i];
+        out << i << "," << s.view;
+        for(int r = 0; r < NUM_DRAW_ROUTINES; r++)
+            out << "," << s.time[r];
+        out << "," << s.draw_calls << "," << s.vertices << "," << s.labels << "," << s.texture_binds << "\n";
+    }
+    return bool(out);
+}
@@ -0,0 +1,83 @@
+/*
+ *  frame_stats.h
+ *  LorenzGL_verHY
+ *
+ *  Time and submission counts of every drawn frame, broken down by draw routine.
+ *
+ */
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#define FRAME_STATS_WINDOW 240 // frames behind the rolling percentiles
+
+// timed parts of a frame, nested parts are included in their callers
+enum draw_routine { DRAW_FRAME, DRAW_VIEW, DRAW_EMBEDDING, DRAW_TIME_SERIES, DRAW_TRACERS,
+                    DRAW_AXES, DRAW_MARKERS, DRAW_CURVES, DRAW_LABELS, DRAW_HUD, NUM_DRAW_ROUTINES };
+
+const char* draw_routine_name(const draw_routine r);
+
+struct frame_sample
+{
+    int view;
+    double time[NUM_DRAW_ROUTINES]; // ms
+    int draw_calls;
+    int vertices;
+    int labels;
+    int texture_binds;
+};
+
+class frame_stats
+{
+public:
+    frame_stats();
+    
+    // nothing is timed or kept while disabled
+    bool enabled() const {return on;}
+    void toggle() {on = !on;}
+    
+    void begin_frame(const int view);
+    void end_frame();
+    void start(const draw_routine r);
+    void stop(const draw_routine r);
+    
+    // counted between begin_frame and end_frame
+    void count_draw(const int num_vertices) {current.draw_calls++; current.vertices += num_vertices;}
+    void count_labels(const int num_labels) {current.labels += num_labels;}
+    void count_texture_bind() {current.texture_binds++;}
+    
+    // p-th percentile (0-100) over those of the last FRAME_STATS_WINDOW frames drawn in view
+    double percentile(const draw_routine r, const double p, const int view) const;
+    const frame_sample & last() const {return recent[(num_frames + FRAME_STATS_WINDOW - 1) % FRAME_STATS_WINDOW];}
+    int count() const {return num_frames;}
+    
+    // every frame since the stats were enabled, one row each
+    bool write_csv(const string filename) const;
+    
+private:
+    bool on;
+    frame_sample current;
+    double start_time[NUM_DRAW_ROUTINES];
+    int depth[NUM_DRAW_ROUTINES]; // recursive calls are timed once
+    int num_frames;
+    vector<frame_sample> recent;  // ring of the last FRAME_STATS_WINDOW frames
+    vector<frame_sample> history;
+};
+
+// times a routine until the end of the scope
+class stats_timer
+{
+public:
+    stats_timer(frame_stats & stats, const draw_routine r) : stats(stats), r(r) {stats.start(r);}
+    ~stats_timer() {stats.stop(r);}
+    
+private:
+    frame_stats & stats;
+    const draw_routine r;
+};
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ *  grid_nn.cpp
+ *  LorenzGL_verHY
+ *
+ *  Exact k nearest neighbor search in 3 dimensions using a hashed uniform
+ *  cell list over a known bounding cube.
+ *
+ */
+
+#include "grid_nn.h"
+#include <cstdlib>
+#include <algorithm>
+#include <math.h>
+
+// keep neighbors sorted by (distance, -index)
+static inline void insert_neighbor(const int s, const double dd, const int nn_num, int & found,
+                                   int* nn_indices, double* nn_sq_distances)
+{
+    int rank;
+
+    if(found < nn_num)
+        rank = found++;
+    else if(dd < nn_sq_distances[nn_num-1] || (dd == nn_sq_distances[nn_num-1] && s > nn_indices[nn_num-1]))
+        rank = nn_num-1;
+    else
+        return;
+
+    for(; rank > 0 && (nn_sq_distances[rank-1] > dd || (nn_sq_distances[rank-1] == dd && nn_indices[rank-1] < s)); rank--)
+    {
+        nn_sq_distances[rank] = nn_sq_distances[rank-1];
+        nn_indices[rank] = nn_indices[rank-1];
+    }
+    nn_sq_distances[rank] = dd;
+    nn_indices[rank] = s;
+    return;
+}
+
+// interleave the low 10 bits of v with two zero bits each
+static unsigned int spread_bits(unsigned int v)
+{
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+static unsigned int morton(const int i, const int j, const int k)
+{
+    return spread_bits(i) | (spread_bits(j) << 1) | (spread_bits(k) << 2);
+}
+
+static inline int hash_cell(const long long id, const int mask)
+{
+    return int(((unsigned long long)id * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+struct residue_less
+{
+    int nn_skip;
+    bool operator()(const int a, const int b) const {return a % nn_skip < b % nn_skip;}
+};
+
+grid_nn::grid_nn(const double* px, const double* py, const double* pz, const int n,
+                 const double lo, const double hi, const int nn_skip, const int cells_per_axis)
+{
+    int per_residue, s, key, size, b;
+    vector<unsigned long long> codes(n);
+    residue_less by_residue;
+
+    this->px = px;
+    this->py = py;
+    this->pz = pz;
+    this->n = n;
+    this->nn_skip = nn_skip;
+    this->lo = lo;
+
+    // the attractors here are close to 2-dimensional, so size the cells for a
+    // few points per occupied cell rather than per cell of the whole cube
+    per_residue = n / nn_skip + 1;
+    G = cells_per_axis;
+    if(G <= 0)
+        G = int(sqrt(per_residue / 4.0));
+    if(G < 1)
+        G = 1;
+    if(G > 1024)
+        G = 1024;
+    h = (hi - lo) / G;
+    if(h <= 0)
+        h = 1;
+    inv_h = 1.0 / h;
+
+    // sort by Morton code of the cell, then time
+    for(s = 0; s < n; s++)
+        codes[s] = ((unsigned long long)morton(cell(px[s]), cell(py[s]), cell(pz[s])) << 32) | (unsigned int)s;
+    sort(codes.begin(), codes.end());
+
+    entry_index.resize(n);
+    for(int e = 0; e < n; e++)
+        entry_index[e] = int(codes[e] & 0xffffffffu);
+
+    // within a cell, group the residue classes keeping time order, and give
+    // every (cell, residue) run its own slot
+    by_residue.nn_skip = nn_skip;
+    cell_id.clear();
+    cell_start.clear();
+    for(int first = 0, last; first < n; first = last)
+    {
+        for(last = first+1; last < n && (codes[last] >> 32) == (codes[first] >> 32); last++);
+        if(nn_skip > 1)
+            stable_sort(entry_index.begin() + first, entry_index.begin() + last, by_residue);
+
+        s = entry_index[first];
+        key = cell(px[s]) + G*(cell(py[s]) + G*cell(pz[s]));
+        for(int e = first; e < last; e++)
+        {
+            if(e == first || entry_index[e] % nn_skip != entry_index[e-1] % nn_skip)
+            {
+                cell_id.push_back((long long)key * nn_skip + entry_index[e] % nn_skip);
+                cell_start.push_back(e);
+            }
+        }
+    }
+    cell_start.push_back(n);
+
+    entry_coords.resize(3*n);
+    for(int e = 0; e < n; e++)
+    {
+        s = entry_index[e];
+        entry_coords[3*e] = px[s];
+        entry_coords[3*e+1] = py[s];
+        entry_coords[3*e+2] = pz[s];
+    }
+
+    size = 16;
+    while(size < 2*int(cell_id.size()))
+        size *= 2;
+    table_mask = size-1;
+    table.assign(size, -1);
+    for(int c = 0; c < cell_id.size(); c++)
+    {
+        for(b = hash_cell(cell_id[c], table_mask); table[b] != -1; b = (b+1) & table_mask);
+        table[b] = c;
+    }
+}
+
+int grid_nn::cell(const double v) const
+{
+    int c = int((v - lo) * inv_h);
+    if(c < 0)
+        return 0;
+    if(c >= G)
+        return G-1;
+    return c;
+}
+
+int grid_nn::find_cell(const int key, const int r) const
+{
+    long long id = (long long)key * nn_skip + r;
+
+    for(int b = hash_cell(id, table_mask); table[b] != -1; b = (b+1) & table_mask)
+    {
+        if(cell_id[table[b]] == id)
+            return table[b];
+    }
+    return -1;
+}
+
+void grid_nn::visit(const int key, const int r, const int s_max, const double qx, const double qy, const double qz,
+                    const int nn_num, int & found, int* nn_indices, double* nn_sq_distances,
+                    const int num_extra, const double* const* extra, const double* q_extra) const
+{
+    int c = find_cell(key, r);
+    const int* first;
+    const int* last;
+    const double* coords;
+    double dx, dy, dz, dd, de;
+
+    if(c < 0)
+        return;
+    first = &entry_index[0] + cell_start[c];
+    last = &entry_index[0] + cell_start[c+1];
+    coords = &entry_coords[0] + 3*cell_start[c];
+
+    // entries of a cell are ascending in index, so the causal ones are a prefix
+    last = upper_bound(first, last, s_max);
+    for(const int* e = first; e < last; e++, coords += 3)
+    {
+        dx = coords[0] - qx;
+        dy = coords[1] - qy;
+        dz = coords[2] - qz;
+        dd = dx*dx + dy*dy + dz*dz;
+        for(int i = 0; i < num_extra; i++)
+        {
+            de = extra[i][*e] - q_extra[i];
+            dd += de*de;
+        }
+        insert_neighbor(*e, dd, nn_num, found, nn_indices, nn_sq_distances);
+    }
+    return;
+}
+
+int grid_nn::scan(const double qx, const double qy, const double qz, const int s_max, const int nn_num,
+                  int* nn_indices, double* nn_sq_distances,
+                  const int num_extra, const double* const* extra, const double* q_extra) const
+{
+    int found = 0;
+    double dx, dy, dz, dd, de;
+
+    for(int s = s_max; s >= 0; s -= nn_skip)
+    {
+        dx = px[s] - qx;
+        dy = py[s] - qy;
+        dz = pz[s] - qz;
+        dd = dx*dx + dy*dy + dz*dz;
+        for(int i = 0; i < num_extra; i++)
+        {
+            de = extra[i][s] - q_extra[i];
+            dd += de*de;
+        }
+        insert_neighbor(s, dd, nn_num, found, nn_indices, nn_sq_distances);
+    }
+    return found;
+}
+
+int grid_nn::query(const double qx, const double qy, const double qz, int s_max, const int nn_num,
+                   int* nn_indices, double* nn_sq_distances,
+                   const int num_extra, const double* const* extra, const double* q_extra) const
+{
+    int found = 0;
+    int ci, cj, ck, r, cells_visited = 0;
+    double bound;
+
+    if(s_max >= n)
+        s_max -= ((s_max - n) / nn_skip + 1) * nn_skip;
+    if(s_max < 0 || nn_num < 1)
+        return 0;
+
+    // with few candidates a direct scan beats walking the cells
+    if(s_max / nn_skip + 1 <= 16*nn_num)
+        return scan(qx, qy, qz, s_max, nn_num, nn_indices, nn_sq_distances, num_extra, extra, q_extra);
+
+    r = s_max % nn_skip;
+    ci = cell(qx);
+    cj = cell(qy);
+    ck = cell(qz);
+
+    // expand shells of cells until the k-th neighbor is closer than anything outside;
+    // extra coordinates only add to distances, so the cell bound still holds
+    for(int R = 0; ; R++)
+    {
+        // early in the series the causal points are sparse in the cells, and
+        // walking many empty shells costs more than looking at every candidate
+        if(cells_visited > s_max / nn_skip + 1)
+            return scan(qx, qy, qz, s_max, nn_num, nn_indices, nn_sq_distances, num_extra, extra, q_extra);
+        
+        for(int i = max(ci-R, 0); i <= min(ci+R, G-1); i++)
+        {
+            for(int j = max(cj-R, 0); j <= min(cj+R, G-1); j++)
+            {
+                if(abs(i-ci) == R || abs(j-cj) == R)
+                {
+                    for(int k = max(ck-R, 0); k <= min(ck+R, G-1); k++, cells_visited++)
+                        visit(i + G*(j + G*k), r, s_max, qx, qy, qz, nn_num, found, nn_indices, nn_sq_distances,
+                              num_extra, extra, q_extra);
+                }
+                else
+                {
+                    cells_visited += 2;
+                    if(ck-R >= 0)
+                        visit(i + G*(j + G*(ck-R)), r, s_max, qx, qy, qz, nn_num, found, nn_indices, nn_sq_distances,
+                              num_extra, extra, q_extra);
+                    if(R > 0 && ck+R < G)
+                        visit(i + G*(j + G*(ck+R)), r, s_max, qx, qy, qz, nn_num, found, nn_indices, nn_sq_distances,
+                              num_extra, extra, q_extra);
+                }
+            }
+        }
+
+        if(ci-R <= 0 && cj-R <= 0 && ck-R <= 0 && ci+R >= G-1 && cj+R >= G-1 && ck+R >= G-1)
+            break;
+
+        if(found == nn_num)
+        {
+            // distance from the query to the nearest unvisited cell
+            bound = HUGE_VAL;
+            if(ci-R > 0)
+                bound = min(bound, qx - (lo + (ci-R)*h));
+            if(ci+R < G-1)
+                bound = min(bound, lo + (ci+R+1)*h - qx);
+            if(cj-R > 0)
+                bound = min(bound, qy - (lo + (cj-R)*h));
+            if(cj+R < G-1)
+                bound = min(bound, lo + (cj+R+1)*h - qy);
+            if(ck-R > 0)
+                bound = min(bound, qz - (lo + (ck-R)*h));
+            if(ck+R < G-1)
+                bound = min(bound, lo + (ck+R+1)*h - qz);
+            bound -= 1e-9*h;
+            if(bound > 0 && bound*bound > nn_sq_distances[nn_num-1])
+                break;
+        }
+    }
+    return found;
+}
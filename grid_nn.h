@@ -0,0 +1,66 @@
+/*
+ *  grid_nn.h
+ *  LorenzGL_verHY
+ *
+ *  Exact k nearest neighbor search in 3 dimensions using a hashed uniform
+ *  cell list over a known bounding cube.
+ *
+ */
+#ifndef GRID_NN_H
+#define GRID_NN_H
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+class grid_nn
+{
+public:
+    // point s is (px[s], py[s], pz[s]) for 0 <= s < n, all coordinates in [lo, hi]
+    // candidates for a query are always s_max, s_max - nn_skip, ..., so each residue
+    // class mod nn_skip gets its own cells
+    grid_nn(const double* px, const double* py, const double* pz, const int n,
+            const double lo, const double hi, const int nn_skip, const int cells_per_axis = 0);
+
+    // nn_num nearest of s_max, s_max - nn_skip, ... >= 0 to (qx, qy, qz), sorted by
+    // distance (ties go to the larger s); returns the number found
+    // points with more than 3 coordinates have extra[0][s] ... extra[num_extra-1][s]
+    // after them, the query q_extra; they count in the distances but not in the cells
+    int query(const double qx, const double qy, const double qz, const int s_max, const int nn_num,
+              int* nn_indices, double* nn_sq_distances,
+              const int num_extra = 0, const double* const* extra = NULL, const double* q_extra = NULL) const;
+
+    // all point indices sorted by the Morton (Z-order) code of their cell, i.e. the
+    // permutation from storage order back to time; querying the points in this
+    // order keeps consecutive searches in the same part of memory
+    const vector<int> & spatial_order() const {return entry_index;}
+
+private:
+    int cell(const double v) const;
+    int find_cell(const int key, const int r) const;
+    int scan(const double qx, const double qy, const double qz, const int s_max, const int nn_num,
+             int* nn_indices, double* nn_sq_distances,
+             const int num_extra, const double* const* extra, const double* q_extra) const;
+    void visit(const int key, const int r, const int s_max, const double qx, const double qy, const double qz,
+               const int nn_num, int & found, int* nn_indices, double* nn_sq_distances,
+               const int num_extra, const double* const* extra, const double* q_extra) const;
+
+    const double* px;
+    const double* py;
+    const double* pz;
+    int n;
+    int nn_skip;
+    double lo;
+    double inv_h;
+    double h;
+    int G; // cells per axis
+    vector<int> entry_index;     // point of each entry: Morton order of cells, then residue, then time
+    vector<double> entry_coords; // x, y, z of each entry, stored contiguously
+    vector<long long> cell_id;   // cell * nn_skip + residue of each occupied cell
+    vector<int> cell_start;      // entries of occupied cell c are [cell_start[c], cell_start[c+1])
+    vector<int> table;           // open addressing hash of cell_id -> occupied cell, -1 if empty
+    int table_mask;
+};
+
+#endif
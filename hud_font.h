@@ -0,0 +1,129 @@
+/*
+ *  hud_font.h
+ *  LorenzGL_verHY
+ *
+ *  1 bit glyphs of printable ASCII for the HUD text of both renderers: GLUT's
+ *  bitmap fonts need a display and core profiles have no glBitmap. Rendered
+ *  from DejaVu Sans at 12 pixels.
+ *
+ */
+#ifndef HUD_FONT_H
+#define HUD_FONT_H
+
+#define HUD_FONT_FIRST 32   // glyph of ' '
+#define HUD_FONT_COUNT 95   // up to '~'
+#define HUD_FONT_WIDTH 16   // bits per row, the leftmost is the most significant
+#define HUD_FONT_HEIGHT 15  // rows per glyph, top row first
+#define HUD_FONT_DESCENT 3  // rows below the baseline
+#define HUD_FONT_ORIGIN 1   // column of the pen position
+
+// pixels to the next glyph's pen position
+static const unsigned char hud_font_advance[HUD_FONT_COUNT] =
+{
+    4, 5, 5, 10, 8, 11, 10, 3, 5, 5, 6, 10, 4, 4, 4, 4, 8, 8, 8,
+    8, 8, 8, 8, 8, 8, 8, 4, 4, 10, 10, 10, 6, 13, 8, 8, 8, 9, 8,
+    7, 9, 9, 3, 3, 7, 6, 10, 9, 9, 8, 9, 8, 8, 7, 9, 8, 11, 7,
+    7, 9, 5, 4, 5, 10, 6, 6, 8, 8, 7, 8, 8, 4, 8, 8, 3, 3, 7,
+    3, 11, 8, 8, 8, 8, 5, 7, 5, 8, 6, 9, 6, 6, 5, 8, 4, 8, 10
+};
+
+static const unsigned short hud_font_rows[HUD_FONT_COUNT][HUD_FONT_HEIGHT] =
+{
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, //  
+    {0x0000, 0x0000, 0x0000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x0000, 0x1000, 0x1000, 0x0000, 0x0000, 0x0000}, // !
+    {0x0000, 0x0000, 0x0000, 0x2800, 0x2800, 0x2800, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, // "
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0480, 0x0500, 0x1fc0, 0x0900, 0x0900, 0x3f80, 0x0a00, 0x1200, 0x0000, 0x0000, 0x0000}, // #
+    {0x0000, 0x0000, 0x0000, 0x0400, 0x0e00, 0x1500, 0x1400, 0x1c00, 0x0700, 0x0500, 0x1500, 0x0e00, 0x0400, 0x0400, 0x0000}, // $
+    {0x0000, 0x0000, 0x0000, 0x3080, 0x4900, 0x4900, 0x4a00, 0x36c0, 0x0520, 0x0920, 0x0920, 0x10c0, 0x0000, 0x0000, 0x0000}, // %
+    {0x0000, 0x0000, 0x0000, 0x0c00, 0x1200, 0x1000, 0x1800, 0x1440, 0x2240, 0x2180, 0x3100, 0x1ec0, 0x0000, 0x0000, 0x0000}, // &
+    {0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, // '
+    {0x0000, 0x0000, 0x1800, 0x1000, 0x1000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x1000, 0x1000, 0x1800, 0x0000, 0x0000}, // (
+    {0x0000, 0x0000, 0x3000, 0x1000, 0x1000, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x1000, 0x1000, 0x3000, 0x0000, 0x0000}, // )
+    {0x0000, 0x0000, 0x0000, 0x0800, 0x2a00, 0x1c00, 0x1c00, 0x2a00, 0x0800, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, // *
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0400, 0x0400, 0x0400, 0x3f80, 0x0400, 0x0400, 0x0400, 0x0000, 0x0000, 0x0000}, // +
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000}, // ,
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x3800, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, // -
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // .
+    {0x0000, 0x0000, 0x0000, 0x0800, 0x0800, 0x1000, 0x1000, 0x1000, 0x2000, 0x2000, 0x2000, 0x4000, 0x4000, 0x0000, 0x0000}, // /
+    {0x0000, 0x0000, 0x0000, 0x1e00, 0x1200, 0x2100, 0x2100, 0x2100, 0x2100, 0x2100, 0x1200, 0x1e00, 0x0000, 0x0000, 0x0000}, // 0
+    {0x0000, 0x0000, 0x0000, 0x3800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x3e00, 0x0000, 0x0000, 0x0000}, // 1
+    {0x0000, 0x0000, 0x0000, 0x1e00, 0x2300, 0x0100, 0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x3f00, 0x0000, 0x0000, 0x0000}, // 2
+    {0x0000, 0x0000, 0x0000, 0x1e00, 0x2100, 0x0100, 0x0100, 0x0e00, 0x0100, 0x0100, 0x2100, 0x1e00, 0x0000, 0x0000, 0x0000}, // 3
+    {0x0000, 0x0000, 0x0000, 0x0600, 0x0600, 0x0a00, 0x1200, 0x1200, 0x2200, 0x3f00, 0x0200, 0x0200, 0x0000, 0x0000, 0x0000}, // 4
+    {0x0000, 0x0000, 0x0000, 0x3e00, 0x2000, 0x2000, 0x3e00, 0x0300, 0x0100, 0x0100, 0x2300, 0x1e00, 0x0000, 0x0000, 0x0000}, // 5
+    {0x0000, 0x0000, 0x0000, 0x0e00, 0x1100, 0x2000, 0x2e00, 0x3300, 0x2100, 0x2100, 0x1300, 0x1e00, 0x0000, 0x0000, 0x0000}, // 6
+    {0x0000, 0x0000, 0x0000, 0x3f00, 0x0100, 0x0200, 0x0200, 0x0400, 0x0400, 0x0800, 0x0800, 0x1000, 0x0000, 0x0000, 0x0000}, // 7
+    {0x0000, 0x0000, 0x0000, 0x1e00, 0x2100, 0x2100, 0x2100, 0x1e00, 0x2100, 0x2100, 0x2100, 0x1e00, 0x0000, 0x0000, 0x0000}, // 8
+    {0x0000, 0x0000, 0x0000, 0x1e00, 0x3200, 0x2100, 0x2100, 0x3300, 0x1d00, 0x0100, 0x2200, 0x1c00, 0x0000, 0x0000, 0x0000}, // 9
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x0000, 0x0000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // :
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000}, // ;
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00c0, 0x0780, 0x3800, 0x3800, 0x0780, 0x00c0, 0x0000, 0x0000, 0x0000, 0x0000}, // <
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x3fc0, 0x0000, 0x3fc0, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, // =
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x3000, 0x1e00, 0x01c0, 0x01c0, 0x1e00, 0x3000, 0x0000, 0x0000, 0x0000, 0x0000}, // >
+    {0x0000, 0x0000, 0x0000, 0x3800, 0x4400, 0x0400, 0x0800, 0x1000, 0x1000, 0x0000, 0x1000, 0x1000, 0x0000, 0x0000, 0x0000}, // ?
+    {0x0000, 0x0000, 0x0000, 0x07c0, 0x0830, 0x1010, 0x23c8, 0x2448, 0x2448, 0x2450, 0x23e0, 0x1000, 0x0820, 0x07c0, 0x0000}, // @
+    {0x0000, 0x0000, 0x0000, 0x0c00, 0x0c00, 0x1200, 0x1200, 0x1200, 0x2100, 0x3f00, 0x2100, 0x4080, 0x0000, 0x0000, 0x0000}, // A
+    {0x0000, 0x0000, 0x0000, 0x3e00, 0x2100, 0x2100, 0x2100, 0x3e00, 0x2100, 0x2100, 0x2100, 0x3e00, 0x0000, 0x0000, 0x0000}, // B
+    {0x0000, 0x0000, 0x0000, 0x0e00, 0x1100, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x1100, 0x0e00, 0x0000, 0x0000, 0x0000}, // C
+    {0x0000, 0x0000, 0x0000, 0x3e00, 0x2100, 0x2080, 0x2080, 0x2080, 0x2080, 0x2080, 0x2100, 0x3e00, 0x0000, 0x0000, 0x0000}, // D
+    {0x0000, 0x0000, 0x0000, 0x3f00, 0x2000, 0x2000, 0x2000, 0x3f00, 0x2000, 0x2000, 0x2000, 0x3f00, 0x0000, 0x0000, 0x0000}, // E
+    {0x0000, 0x0000, 0x0000, 0x3e00, 0x2000, 0x2000, 0x2000, 0x3e00, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // F
+    {0x0000, 0x0000, 0x0000, 0x0f00, 0x1080, 0x2000, 0x2000, 0x2380, 0x2080, 0x2080, 0x1080, 0x0f00, 0x0000, 0x0000, 0x0000}, // G
+    {0x0000, 0x0000, 0x0000, 0x2080, 0x2080, 0x2080, 0x2080, 0x3f80, 0x2080, 0x2080, 0x2080, 0x2080, 0x0000, 0x0000, 0x0000}, // H
+    {0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // I
+    {0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0xc000, 0x0000}, // J
+    {0x0000, 0x0000, 0x0000, 0x2100, 0x2200, 0x2400, 0x2800, 0x3000, 0x2800, 0x2400, 0x2200, 0x2100, 0x0000, 0x0000, 0x0000}, // K
+    {0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x3e00, 0x0000, 0x0000, 0x0000}, // L
+    {0x0000, 0x0000, 0x0000, 0x2040, 0x30c0, 0x30c0, 0x2940, 0x2940, 0x2640, 0x2640, 0x2040, 0x2040, 0x0000, 0x0000, 0x0000}, // M
+    {0x0000, 0x0000, 0x0000, 0x3080, 0x3080, 0x2880, 0x2880, 0x2480, 0x2280, 0x2280, 0x2180, 0x2180, 0x0000, 0x0000, 0x0000}, // N
+    {0x0000, 0x0000, 0x0000, 0x0e00, 0x1100, 0x2080, 0x2080, 0x2080, 0x2080, 0x2080, 0x1100, 0x0e00, 0x0000, 0x0000, 0x0000}, // O
+    {0x0000, 0x0000, 0x0000, 0x3e00, 0x2100, 0x2100, 0x2100, 0x3e00, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // P
+    {0x0000, 0x0000, 0x0000, 0x0e00, 0x1100, 0x2080, 0x2080, 0x2080, 0x2080, 0x2080, 0x1100, 0x0e00, 0x0200, 0x0100, 0x0000}, // Q
+    {0x0000, 0x0000, 0x0000, 0x3e00, 0x2100, 0x2100, 0x2100, 0x3e00, 0x2200, 0x2100, 0x2100, 0x2080, 0x0000, 0x0000, 0x0000}, // R
+    {0x0000, 0x0000, 0x0000, 0x1e00, 0x2100, 0x2000, 0x2000, 0x1e00, 0x0100, 0x0100, 0x2100, 0x1e00, 0x0000, 0x0000, 0x0000}, // S
+    {0x0000, 0x0000, 0x0000, 0x7f00, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0000, 0x0000, 0x0000}, // T
+    {0x0000, 0x0000, 0x0000, 0x2080, 0x2080, 0x2080, 0x2080, 0x2080, 0x2080, 0x2080, 0x3180, 0x1f00, 0x0000, 0x0000, 0x0000}, // U
+    {0x0000, 0x0000, 0x0000, 0x4080, 0x4080, 0x2100, 0x2100, 0x2100, 0x1200, 0x1200, 0x0c00, 0x0c00, 0x0000, 0x0000, 0x0000}, // V
+    {0x0000, 0x0000, 0x0000, 0x4210, 0x2220, 0x2220, 0x2520, 0x1540, 0x1540, 0x1540, 0x0880, 0x0880, 0x0000, 0x0000, 0x0000}, // W
+    {0x0000, 0x0000, 0x0000, 0x6300, 0x2200, 0x1400, 0x1400, 0x0800, 0x1400, 0x1400, 0x2200, 0x4100, 0x0000, 0x0000, 0x0000}, // X
+    {0x0000, 0x0000, 0x0000, 0x4100, 0x2200, 0x2200, 0x1400, 0x1400, 0x0800, 0x0800, 0x0800, 0x0800, 0x0000, 0x0000, 0x0000}, // Y
+    {0x0000, 0x0000, 0x0000, 0x3f80, 0x0080, 0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x3f80, 0x0000, 0x0000, 0x0000}, // Z
+    {0x0000, 0x0000, 0x0000, 0x1800, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1800, 0x0000}, // [
+    {0x0000, 0x0000, 0x0000, 0x4000, 0x4000, 0x2000, 0x2000, 0x2000, 0x1000, 0x1000, 0x1000, 0x0800, 0x0800, 0x0000, 0x0000}, // backslash
+    {0x0000, 0x0000, 0x0000, 0x3000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x3000, 0x0000}, // ]
+    {0x0000, 0x0000, 0x0000, 0x0600, 0x0900, 0x1080, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, // ^
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x7e00}, // _
+    {0x0000, 0x0000, 0x1000, 0x0800, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}, // `
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1e00, 0x2100, 0x0100, 0x1f00, 0x2100, 0x2300, 0x1d00, 0x0000, 0x0000, 0x0000}, // a
+    {0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x3e00, 0x3300, 0x2100, 0x2100, 0x2100, 0x3300, 0x3e00, 0x0000, 0x0000, 0x0000}, // b
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1c00, 0x3200, 0x2000, 0x2000, 0x2000, 0x3200, 0x1c00, 0x0000, 0x0000, 0x0000}, // c
+    {0x0000, 0x0000, 0x0100, 0x0100, 0x0100, 0x1f00, 0x3300, 0x2100, 0x2100, 0x2100, 0x3300, 0x1f00, 0x0000, 0x0000, 0x0000}, // d
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1e00, 0x3300, 0x2100, 0x3f00, 0x2000, 0x3100, 0x1e00, 0x0000, 0x0000, 0x0000}, // e
+    {0x0000, 0x0000, 0x1800, 0x2000, 0x2000, 0x7800, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // f
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1f00, 0x3300, 0x2100, 0x2100, 0x2100, 0x3300, 0x1f00, 0x0100, 0x1300, 0x0e00}, // g
+    {0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2e00, 0x3100, 0x2100, 0x2100, 0x2100, 0x2100, 0x2100, 0x0000, 0x0000, 0x0000}, // h
+    {0x0000, 0x0000, 0x0000, 0x2000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // i
+    {0x0000, 0x0000, 0x0000, 0x2000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x6000}, // j
+    {0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2200, 0x2400, 0x2800, 0x3000, 0x2800, 0x2400, 0x2200, 0x0000, 0x0000, 0x0000}, // k
+    {0x0000, 0x0000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // l
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x3dc0, 0x2220, 0x2220, 0x2220, 0x2220, 0x2220, 0x2220, 0x0000, 0x0000, 0x0000}, // m
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2e00, 0x3100, 0x2100, 0x2100, 0x2100, 0x2100, 0x2100, 0x0000, 0x0000, 0x0000}, // n
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1e00, 0x3300, 0x2100, 0x2100, 0x2100, 0x3300, 0x1e00, 0x0000, 0x0000, 0x0000}, // o
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x3e00, 0x3300, 0x2100, 0x2100, 0x2100, 0x3300, 0x3e00, 0x2000, 0x2000, 0x2000}, // p
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1f00, 0x3300, 0x2100, 0x2100, 0x2100, 0x3300, 0x1f00, 0x0100, 0x0100, 0x0100}, // q
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2c00, 0x3000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x0000, 0x0000, 0x0000}, // r
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1c00, 0x2200, 0x2000, 0x1c00, 0x0200, 0x2200, 0x1c00, 0x0000, 0x0000, 0x0000}, // s
+    {0x0000, 0x0000, 0x0000, 0x2000, 0x2000, 0x7800, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x3800, 0x0000, 0x0000, 0x0000}, // t
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2100, 0x2100, 0x2100, 0x2100, 0x2100, 0x2300, 0x1d00, 0x0000, 0x0000, 0x0000}, // u
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x4200, 0x4200, 0x2400, 0x2400, 0x2400, 0x1800, 0x1800, 0x0000, 0x0000, 0x0000}, // v
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x4440, 0x4440, 0x2a80, 0x2a80, 0x2a80, 0x1100, 0x1100, 0x0000, 0x0000, 0x0000}, // w
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x4200, 0x2400, 0x2400, 0x1800, 0x2400, 0x2400, 0x4200, 0x0000, 0x0000, 0x0000}, // x
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x4200, 0x4200, 0x2400, 0x2400, 0x1400, 0x1800, 0x0800, 0x0800, 0x1000, 0x6000}, // y
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x7c00, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, 0x7c00, 0x0000, 0x0000, 0x0000}, // z
+    {0x0000, 0x0000, 0x0000, 0x0700, 0x0400, 0x0400, 0x0400, 0x0400, 0x1800, 0x0400, 0x0400, 0x0400, 0x0400, 0x0700, 0x0000}, // {
+    {0x0000, 0x0000, 0x0000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000, 0x1000}, // |
+    {0x0000, 0x0000, 0x0000, 0x3800, 0x0800, 0x0800, 0x0800, 0x0800, 0x0600, 0x0800, 0x0800, 0x0800, 0x0800, 0x3800, 0x0000}, // }
+    {0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1c40, 0x2380, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000}  // ~
+};
+
+#endif
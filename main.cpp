@@ -8,18 +8,32 @@
  */
 
 #include <cstdlib>
+#include <cstring>
+#include <climits>
 #include <iostream>
+#include <unistd.h>
+#include <ctime>
 #include <GLUT/glut.h>
+#ifdef __APPLE__
+#include <OpenGL/OpenGL.h>
+#endif
 #include "attractor.h"
+#include "ccm.h"
+#include "surrogate.h"
+#include "multiview.h"
+#include "movie.h"
+#include "renderer.h"
 
 using namespace std;
 
 enum button { LEFT, MIDDLE, RIGHT, OFF };
+enum pace_mode { PACE_RUNNING, PACE_SLOW, PACE_PAUSED }; // slow: fewer new frames than max_fps
 bool PAUSED, PREV_PAUSED;
 bool TAKENS_VIEW;
 draw_mode PREV_VIEW;
 bool FULLSCREEN;
 bool MOVIE;
+bool CORE_PROFILE; // -core: draw with buffers and shaders in an OpenGL 3.2+ core profile context
 
 attractor* a;
 
@@ -37,13 +51,34 @@ const double TRANSLATION_SCALE = 0.01;
 const int max_frames = 10000;
 double runtime;
 
+// redraw scheduling
+double max_fps;        // redraws per second at most, on top of the display refresh
+bool REDRAW;           // something changed since the last redraw
+bool WAITING;          // idle callback removed until the next input
+int shown_frame;       // frame of the last redraw
+double last_redraw;    // ms
+double sample_wall, sample_cpu;
+double pace_wall[3], pace_cpu[3]; // seconds spent in each pace_mode
+int pace_redraws[3];
+string launch_dir;     // attractor::init changes to the resource directory
+
+pace_mode current_pace();
 void display();
 void reshape(int width, int height);
 void mouse(int b, int s, int x, int y);
 void motion(int x, int y);
 void keyboard(unsigned char k, int x, int y);
 void idle();
+void request_redraw();
+void quit();
 void initGL();
+int run_xmap_matrix(int argc, char* argv[]);
+int run_nn_benchmark(int argc, char* argv[]);
+int run_forecast_curves(int argc, char* argv[]);
+int run_surrogate_test(int argc, char* argv[]);
+int run_multiview(int argc, char* argv[]);
+int run_movie_export(int argc, char* argv[]);
+int run_renderer_benchmark(int argc, char* argv[]);
 
 void reset_window_title(int param)
 {
@@ -53,12 +88,55 @@ void reset_window_title(int param)
 
 int main(int argc, char* argv[])
 {
+    // -core may appear anywhere, take it out before the modes read their positional arguments
+    int num_args = 1;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-core") == 0)
+            CORE_PROFILE = true;
+        else
+            argv[num_args++] = argv[i];
+    }
+    argv[num_args] = NULL;
+    argc = num_args;
+    if(argc > 2 && strcmp(argv[1], "-x") == 0)
+        return run_xmap_matrix(argc, argv);
+    if(argc > 1 && strcmp(argv[1], "-b") == 0)
+        return run_nn_benchmark(argc, argv);
+    if(argc > 2 && (strcmp(argv[1], "-f") == 0 || strcmp(argv[1], "-c") == 0))
+        return run_forecast_curves(argc, argv);
+    if(argc > 2 && strcmp(argv[1], "-s") == 0)
+        return run_surrogate_test(argc, argv);
+    if(argc > 2 && strcmp(argv[1], "-v") == 0)
+        return run_multiview(argc, argv);
+    if(argc > 2 && strcmp(argv[1], "-o") == 0)
+        return run_movie_export(argc, argv);
+    if(argc > 1 && strcmp(argv[1], "-p") == 0)
+        return run_renderer_benchmark(argc, argv);
+    
     if(argc > 1 && strcmp(argv[1], "-m") == 0)
         MOVIE = true;
+    max_fps = 60;
+    for(int i = 1; i+1 < argc; i++)
+    {
+        if(strcmp(argv[i], "-r") == 0)
+            max_fps = atof(argv[i+1]);
+    }
+    if(max_fps <= 0)
+    {
+        cerr << "ERROR: -r max_fps must be positive.\n";
+        return 1;
+    }
     
     glutInit(&argc, argv);
     
+#ifdef GLUT_3_2_CORE_PROFILE
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH | (CORE_PROFILE ? GLUT_3_2_CORE_PROFILE : 0));
+#else
+    if(CORE_PROFILE)
+        cerr << "WARNING: this GLUT cannot create core profile windows, using a legacy one.\n";
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+#endif
     
 	glutInitWindowSize(800, 600);
     glutCreateWindow("");
@@ -79,10 +157,24 @@ int main(int argc, char* argv[])
 	speed = 16;
 	
 	initGL();
+    char cwd[PATH_MAX];
+    if(getcwd(cwd, sizeof(cwd)) != NULL)
+        launch_dir = cwd;
+#ifdef __APPLE__
+    // wait for the display refresh when swapping
+    GLint swap_interval = 1;
+    CGLSetParameter(CGLGetCurrentContext(), kCGLCPSwapInterval, &swap_interval);
+#endif
 	a = new attractor(max_frames);
 	a->init(MOVIE);
 	a->set_view(1);
 	runtime = 0;
+    REDRAW = true;
+    WAITING = false;
+    shown_frame = -1;
+    last_redraw = -1000;
+    sample_wall = glutGet(GLUT_ELAPSED_TIME);
+    sample_cpu = double(clock()) / CLOCKS_PER_SEC;
     
     glutMainLoop();
     return 0;
@@ -92,11 +184,14 @@ void display()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	
-	glPushMatrix();
 	a->draw(runtime);
-	glPopMatrix();
 	
     glutSwapBuffers();
+    
+    REDRAW = false;
+    shown_frame = int(runtime);
+    last_redraw = glutGet(GLUT_ELAPSED_TIME);
+    pace_redraws[current_pace()]++;
 }
 
 void reshape(int width, int height)
@@ -108,6 +203,7 @@ void reshape(int width, int height)
     glViewport(0, 0, width, height);
 	my_width = width;
 	my_height = height;
+    request_redraw();
 	a->change_scale(min(width/800.0, height/600.0));
 	a->set_window_size(width, height);
 	if(a->VIEW == XMAP || a->VIEW == XMAP_TS || a->VIEW == UNIVARIATE_TS)
@@ -118,6 +214,7 @@ void reshape(int width, int height)
 
 void mouse(int b, int s, int x, int y)
 {
+    request_redraw();
 	switch(b)
 	{
 		case GLUT_LEFT_BUTTON:
@@ -144,6 +241,7 @@ void mouse(int b, int s, int x, int y)
 
 void motion(int x, int y)
 {
+    request_redraw();
 	if (my_button == LEFT)
 	{
 		rotx = ROTATION_SCALE * double(x - px);
@@ -168,6 +266,7 @@ void motion(int x, int y)
 
 void keyboard(unsigned char k, int x, int y)
 {
+    request_redraw();
     if(MOVIE)
     {
         switch(k)
@@ -175,7 +274,7 @@ void keyboard(unsigned char k, int x, int y)
             case 27:
             case 'q':
             case 'Q':
-                exit (0);
+                quit();
                 break;
             case 'f':
             case 'F':
@@ -212,7 +311,7 @@ void keyboard(unsigned char k, int x, int y)
             case 27:
             case 'q':
             case 'Q':
-                exit (0);
+                quit();
                 break;
             case 'f':
             case 'F':
@@ -295,6 +394,21 @@ void keyboard(unsigned char k, int x, int y)
             case 'K':
                 a->toggle_color_method();
                 break;
+            case 'h':
+            case 'H':
+                a->toggle_skill_hud();
+                break;
+            case 'p':
+            case 'P':
+                a->toggle_frame_stats();
+                break;
+            case 'o':
+            case 'O':
+                if(a->write_frame_stats(launch_dir + "/frame_stats.csv"))
+                    cerr << "wrote " << launch_dir << "/frame_stats.csv\n";
+                else
+                    cerr << "ERROR: cannot write " << launch_dir << "/frame_stats.csv\n";
+                break;
             case 'l':
             case 'L':
                 a->toggle_tsview();
@@ -308,6 +422,24 @@ void keyboard(unsigned char k, int x, int y)
             case ',':
                 a->inc_xtau();
                 break;
+            case '-':
+                a->change_tau(-1);
+                break;
+            case '=':
+                a->change_tau(1);
+                break;
+            case ';':
+                a->change_nn_num(-1);
+                break;
+            case '\'':
+                a->change_nn_num(1);
+                break;
+            case '<':
+                a->change_nn_skip(-1);
+                break;
+            case '>':
+                a->change_nn_skip(1);
+                break;
             case '.':
                 a->inc_ytau();
                 break;
@@ -349,10 +481,31 @@ void keyboard(unsigned char k, int x, int y)
     return;
 }
 
+pace_mode current_pace()
+{
+    if(PAUSED)
+        return PACE_PAUSED;
+    return 1000.0 / speed < max_fps ? PACE_SLOW : PACE_RUNNING;
+}
+
+void sample_pace()
+{
+    double c_wall = glutGet(GLUT_ELAPSED_TIME);
+    double c_cpu = double(clock()) / CLOCKS_PER_SEC;
+    
+    pace_wall[current_pace()] += (c_wall - sample_wall) / 1000;
+    pace_cpu[current_pace()] += c_cpu - sample_cpu;
+    sample_wall = c_wall;
+    sample_cpu = c_cpu;
+    return;
+}
+
 void idle()
 {
 	double c_time = glutGet(GLUT_ELAPSED_TIME);
+    double wait;
 	
+    sample_pace();
 	// increment frame appropriately
 	if(!PAUSED)
 	{
@@ -376,28 +529,88 @@ void idle()
     rotx = 0;
     roty = 0;
 	
+    // the picture only changes with the frame, input or a finished rebuild
+    if(int(runtime) != shown_frame || (a->rebuilding() && a->rebuild_finished()))
+        REDRAW = true;
+    if(!REDRAW)
+    {
+        if(PAUSED && !a->rebuilding())
+        {
+            // nothing will change until the next input
+            WAITING = true;
+            glutIdleFunc(NULL);
+            return;
+        }
+        // sleep until the next frame is due, but stay responsive to input
+        wait = PAUSED ? 1000 / max_fps : (floor(runtime) + 1 - runtime) * speed;
+        usleep(1000 * min(wait, 1000 / max_fps));
+        return;
+    }
+    
+    // cap the redraw rate
+    wait = last_redraw + 1000 / max_fps - c_time;
+    if(wait > 0)
+    {
+        usleep(1000 * wait);
+        return;
+    }
+	
 	// draw
     glutPostRedisplay();
 	return;
 }
 
-void initGL()
+void request_redraw()
 {
-	glShadeModel(GL_SMOOTH);
+    REDRAW = true;
+    if(WAITING)
+    {
+        // time spent waiting was paused time
+        sample_pace();
+        p_time = glutGet(GLUT_ELAPSED_TIME);
+        WAITING = false;
+        glutIdleFunc(idle);
+    }
+    return;
+}
+
+// prints the time, redraw rate and cpu use of each pace mode before exiting
+void quit()
+{
+    const char* names[3] = {"running", "slow", "paused"};
     
+    sample_pace();
+    for(int mode = 0; mode < 3; mode++)
+    {
+        if(pace_wall[mode] <= 0)
+            continue;
+        cerr << names[mode] << ": " << pace_wall[mode] << " s, " << pace_redraws[mode] / pace_wall[mode]
+             << " redraws/s, cpu " << 100 * pace_cpu[mode] / pace_wall[mode] << "% of a core\n";
+    }
+    exit(0);
+}
+
+void initGL()
+{
     glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     glEnable(GL_MULTISAMPLE);
     
-    glEnable(GL_POINT_SMOOTH);
-	glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-    
-    glEnable(GL_LINE_SMOOTH);
-    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-	
-    glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
-    glPolygonMode(GL_FRONT, GL_FILL);
+    // core profile renderers smooth points and lines in their shaders
+    if(!core_profile_context())
+    {
+        glShadeModel(GL_SMOOTH);
+        
+        glEnable(GL_POINT_SMOOTH);
+        glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+        
+        glEnable(GL_LINE_SMOOTH);
+        glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+        
+        glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+        glPolygonMode(GL_FRONT, GL_FILL);
+    }
 	//glEnable(GL_DEPTH_TEST);
   	
 	glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
@@ -409,3 +622,281 @@ void initGL()
 	p_time = 0;
 	return;
 }
+
+// -x data.csv [E] [tau] [nn_num] [nn_skip]
+// prints the matrix of cross map skill (row = library, column = target)
+int run_xmap_matrix(int argc, char* argv[])
+{
+    vector<vector<double> > series;
+    int E = 3, tau = 1, nn_num, nn_skip = 1;
+    
+    if(argc > 3)
+        E = atoi(argv[3]);
+    if(argc > 4)
+        tau = atoi(argv[4]);
+    nn_num = E + 1;
+    if(argc > 5)
+        nn_num = atoi(argv[5]);
+    if(argc > 6)
+        nn_skip = atoi(argv[6]);
+    if(E < 1 || tau < 1 || nn_num < 1 || nn_skip < 1)
+    {
+        cerr << "ERROR: E, tau, nn_num and nn_skip must be positive.\n";
+        return 1;
+    }
+    
+    if(!load_series(argv[2], series))
+        return 1;
+    
+    cerr << "cross mapping " << series.size() << " variables...";
+    xmap_matrix matrix(series, E, tau, nn_num, nn_skip);
+    matrix.compute();
+    cerr << "done!\n";
+    
+    matrix.write(cout);
+    return 0;
+}
+
+// -b [max_n] [nn_num] [nn_skip] [theiler]
+// prints timings of the grid and brute force neighbor searches as csv
+int run_nn_benchmark(int argc, char* argv[])
+{
+    int max_n = 1000000, nn_num = 4, nn_skip = 5, theiler = 0;
+    
+    if(argc > 2)
+        max_n = atoi(argv[2]);
+    if(argc > 3)
+        nn_num = atoi(argv[3]);
+    if(argc > 4)
+        nn_skip = atoi(argv[4]);
+    if(argc > 5)
+        theiler = atoi(argv[5]);
+    if(max_n < 1000 || max_n > 100000000 || nn_num < 1 || nn_skip < 1 || theiler < 0)
+    {
+        cerr << "ERROR: need 1000 <= max_n <= 10^8, positive nn_num and nn_skip, theiler >= 0.\n";
+        return 1;
+    }
+    
+    nn_benchmark(cout, max_n, nn_num, nn_skip, theiler);
+    return 0;
+}
+
+// -f data.csv [E] [tau] [nn_num] [nn_skip] [max_tp]
+// -c data.csv [E] [tau] [theiler] [num_folds] [max_tp]
+// prints forecast skill against horizon, one row per tp and one column per variable;
+// -c uses leave-one-out (num_folds <= 1) or k-fold neighbors instead of causal ones
+int run_forecast_curves(int argc, char* argv[])
+{
+    vector<vector<double> > series, rho;
+    bool cross_validate = strcmp(argv[1], "-c") == 0;
+    int E = 3, tau = 1, nn_num, nn_skip = 1, max_tp = 10;
+    int theiler = 0, num_folds = 0;
+    
+    if(argc > 3)
+        E = atoi(argv[3]);
+    if(argc > 4)
+        tau = atoi(argv[4]);
+    nn_num = E + 1;
+    if(cross_validate)
+    {
+        if(argc > 5)
+            theiler = atoi(argv[5]);
+        if(argc > 6)
+            num_folds = atoi(argv[6]);
+    }
+    else
+    {
+        if(argc > 5)
+            nn_num = atoi(argv[5]);
+        if(argc > 6)
+            nn_skip = atoi(argv[6]);
+    }
+    if(argc > 7)
+        max_tp = atoi(argv[7]);
+    if(E < 1 || tau < 1 || nn_num < 1 || nn_skip < 1 || max_tp < 1 || theiler < 0)
+    {
+        cerr << "ERROR: E, tau, nn_num, nn_skip and max_tp must be positive, theiler >= 0.\n";
+        return 1;
+    }
+    
+    if(!load_series(argv[2], series))
+        return 1;
+    
+    cerr << "forecasting " << series.size() << " variables...";
+    if(cross_validate)
+        cv_forecast_curves(series, E, tau, nn_num, theiler, num_folds, max_tp, rho);
+    else
+        forecast_curves(series, E, tau, nn_num, nn_skip, max_tp, rho);
+    cerr << "done!\n";
+    
+    for(int tp = 1; tp <= max_tp; tp++)
+    {
+        cout << tp;
+        for(int var = 0; var < rho.size(); var++)
+            cout << "," << rho[var][tp-1];
+        cout << "\n";
+    }
+    return 0;
+}
+
+// -s data.csv [shuffle | fourier | twin] [num_surrogates] [E] [tau] [nn_num] [nn_skip]
+// prints the p-value of every cross map skill against surrogates of the target
+int run_surrogate_test(int argc, char* argv[])
+{
+    vector<vector<double> > series;
+    surrogate_type type = SURR_FOURIER;
+    int num_surrogates = 1000, E = 3, tau = 1, nn_num, nn_skip = 1;
+    
+    if(argc > 3)
+    {
+        if(strcmp(argv[3], "shuffle") == 0)
+            type = SURR_SHUFFLE;
+        else if(strcmp(argv[3], "fourier") == 0)
+            type = SURR_FOURIER;
+        else if(strcmp(argv[3], "twin") == 0)
+            type = SURR_TWIN;
+        else
+        {
+            cerr << "ERROR: unknown surrogate type " << argv[3] << ", use shuffle, fourier or twin.\n";
+            return 1;
+        }
+    }
+    if(argc > 4)
+        num_surrogates = atoi(argv[4]);
+    if(argc > 5)
+        E = atoi(argv[5]);
+    if(argc > 6)
+        tau = atoi(argv[6]);
+    nn_num = E + 1;
+    if(argc > 7)
+        nn_num = atoi(argv[7]);
+    if(argc > 8)
+        nn_skip = atoi(argv[8]);
+    if(num_surrogates < 1 || E < 1 || tau < 1 || nn_num < 1 || nn_skip < 1)
+    {
+        cerr << "ERROR: num_surrogates, E, tau, nn_num and nn_skip must be positive.\n";
+        return 1;
+    }
+    
+    if(!load_series(argv[2], series))
+        return 1;
+    
+    cerr << "testing " << series.size() << " variables against " << num_surrogates << " surrogates...";
+    surrogate_test test(series, E, tau, nn_num, nn_skip, type, num_surrogates);
+    test.compute();
+    cerr << "done!\n";
+    
+    test.write(cout);
+    return 0;
+}
+
+// -v data.csv [target] [E] [max_lag] [tau] [tp] [nn_skip] [num_top]
+// prints the multiview ensemble skill and the views it averaged
+int run_multiview(int argc, char* argv[])
+{
+    vector<vector<double> > series;
+    int target = 0, E = 3, max_lag = 3, tau = 1, tp = 1, nn_skip = 1, num_top = 0;
+    
+    if(argc > 3)
+        target = atoi(argv[3]);
+    if(argc > 4)
+        E = atoi(argv[4]);
+    if(argc > 5)
+        max_lag = atoi(argv[5]);
+    if(argc > 6)
+        tau = atoi(argv[6]);
+    if(argc > 7)
+        tp = atoi(argv[7]);
+    if(argc > 8)
+        nn_skip = atoi(argv[8]);
+    if(argc > 9)
+        num_top = atoi(argv[9]);
+    if(E < 1 || max_lag < 1 || tau < 1 || tp < 1 || nn_skip < 1 || num_top < 0)
+    {
+        cerr << "ERROR: E, max_lag, tau, tp and nn_skip must be positive.\n";
+        return 1;
+    }
+    
+    if(!load_series(argv[2], series))
+        return 1;
+    if(target < 0 || target >= series.size())
+    {
+        cerr << "ERROR: target must be a column of " << argv[2] << ".\n";
+        return 1;
+    }
+    
+    multiview mv(series, target, E, max_lag, tau, tp, nn_skip);
+    cerr << "evaluating " << mv.num_views() << " embeddings...";
+    mv.compute(num_top);
+    cerr << "done!\n";
+    
+    mv.write(cout);
+    return 0;
+}
+
+// -o output_dir [num_frames] [frame_step] [width] [height] [num_threads] [-core]
+// renders the movie without a window, frame i at time (i+1)*frame_step, into
+// output_dir/frame_00000.png ...; output_dir - streams raw top-down RGBA to stdout
+int run_movie_export(int argc, char* argv[])
+{
+    string output = argv[2];
+    int num_frames = max_frames, width = 800, height = 600, num_threads = 0;
+    double frame_step = 1;
+    
+    if(argc > 3)
+        num_frames = atoi(argv[3]);
+    if(argc > 4)
+        frame_step = atof(argv[4]);
+    if(argc > 5)
+        width = atoi(argv[5]);
+    if(argc > 6)
+        height = atoi(argv[6]);
+    if(argc > 7)
+        num_threads = atoi(argv[7]);
+    if(num_frames < 1 || frame_step <= 0 || width < 1 || height < 1 || num_threads < 0)
+    {
+        cerr << "ERROR: num_frames, frame_step, width and height must be positive.\n";
+        return 1;
+    }
+    
+    // init() changes to the resource directory
+    if(output != "-" && output[0] != '/')
+    {
+        char cwd[PATH_MAX];
+        if(getcwd(cwd, sizeof(cwd)) == NULL)
+        {
+            cerr << "ERROR: cannot resolve " << output << ".\n";
+            return 1;
+        }
+        output = string(cwd) + "/" + output;
+    }
+    
+    cerr << "rendering " << num_frames << " frames...\n";
+    if(!export_movie(output, num_frames, frame_step, width, height, max_frames, initGL, num_threads, CORE_PROFILE))
+        return 1;
+    cerr << "done!\n";
+    return 0;
+}
+
+// -p [num_frames] [width] [height]
+// prints the ms per frame of every view with the legacy and the core profile renderer
+int run_renderer_benchmark(int argc, char* argv[])
+{
+    int num_frames = 100, width = 800, height = 600;
+    
+    if(argc > 2)
+        num_frames = atoi(argv[2]);
+    if(argc > 3)
+        width = atoi(argv[3]);
+    if(argc > 4)
+        height = atoi(argv[4]);
+    if(num_frames < 1 || num_frames > max_frames/2 || width < 1 || height < 1)
+    {
+        cerr << "ERROR: need 1 <= num_frames <= " << max_frames/2 << ", positive width and height.\n";
+        return 1;
+    }
+    
+    if(!renderer_benchmark(cout, num_frames, width, height, max_frames, initGL))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ *  matrix_stack.cpp
+ *  LorenzGL_verHY
+ *
+ *  Modelview and projection matrices kept on the CPU, so they can be read
+ *  without asking the GL; only the resulting matrices are sent to the GL.
+ *
+ */
+
+#include "matrix_stack.h"
+#include <algorithm>
+#include <math.h>
+
+void multiply_matrix(const double* a, const double* b, double* product)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        for(int j = 0; j < 4; j++)
+        {
+            product[i+4*j] = a[i]*b[4*j] + a[i+4]*b[4*j+1] + a[i+8]*b[4*j+2] + a[i+12]*b[4*j+3];
+        }
+    }
+    return;
+}
+
+void identity_matrix(double* m)
+{
+    for(int i = 0; i < 16; i++)
+        m[i] = (i % 5 == 0);
+    return;
+}
+
+quaternion quaternion::from_axis_angle(const double angle, const double ax, const double ay, const double az)
+{
+    double length = sqrt(ax*ax + ay*ay + az*az);
+    double half = angle * M_PI / 360.0;
+    double s;
+    
+    if(length == 0)
+        return quaternion();
+    s = sin(half) / length;
+    return quaternion(cos(half), ax*s, ay*s, az*s);
+}
+
+quaternion quaternion::operator*(const quaternion & q) const
+{
+    return quaternion(w*q.w - x*q.x - y*q.y - z*q.z,
+                      w*q.x + x*q.w + y*q.z - z*q.y,
+                      w*q.y - x*q.z + y*q.w + z*q.x,
+                      w*q.z + x*q.y - y*q.x + z*q.w);
+}
+
+void quaternion::to_matrix(double* m) const
+{
+    m[0] = 1 - 2*(y*y + z*z);
+    m[1] = 2*(x*y + w*z);
+    m[2] = 2*(x*z - w*y);
+    m[3] = 0;
+    m[4] = 2*(x*y - w*z);
+    m[5] = 1 - 2*(x*x + z*z);
+    m[6] = 2*(y*z + w*x);
+    m[7] = 0;
+    m[8] = 2*(x*z + w*y);
+    m[9] = 2*(y*z - w*x);
+    m[10] = 1 - 2*(x*x + y*y);
+    m[11] = 0;
+    m[12] = m[13] = m[14] = 0;
+    m[15] = 1;
+    return;
+}
+
+matrix_stack::matrix_stack()
+{
+    modelview.resize(16);
+    projection.resize(16);
+    identity_matrix(&modelview[0]);
+    identity_matrix(&projection[0]);
+    curr_mode = GL_MODELVIEW;
+    fixed_function = true;
+    changes = 0;
+}
+
+void matrix_stack::mode(const GLenum new_mode)
+{
+    curr_mode = new_mode;
+    if(fixed_function)
+        glMatrixMode(new_mode);
+    return;
+}
+
+void matrix_stack::push()
+{
+    vector<double> & stack = current();
+    double top[16];
+
+    // insert may not take its range from the vector it grows
+    copy(stack.end()-16, stack.end(), top);
+    stack.insert(stack.end(), top, top+16);
+    return;
+}
+
+void matrix_stack::pop()
+{
+    vector<double> & stack = current();
+    if(stack.size() <= 16)
+        return;
+    stack.resize(stack.size()-16);
+    upload();
+    return;
+}
+
+void matrix_stack::load_identity()
+{
+    identity_matrix(&current()[current().size()-16]);
+    upload();
+    return;
+}
+
+void matrix_stack::load(const double* m)
+{
+    vector<double> & stack = current();
+    copy(m, m+16, stack.end()-16);
+    upload();
+    return;
+}
+
+void matrix_stack::mult(const double* m)
+{
+    vector<double> & stack = current();
+    double product[16];
+    multiply_matrix(&stack[stack.size()-16], m, product);
+    copy(product, product+16, stack.end()-16);
+    upload();
+    return;
+}
+
+void matrix_stack::translate(const double x, const double y, const double z)
+{
+    double* m = &current()[current().size()-16];
+    for(int i = 0; i < 4; i++)
+        m[12+i] += m[i]*x + m[4+i]*y + m[8+i]*z;
+    upload();
+    return;
+}
+
+void matrix_stack::rotate(const double angle, const double x, const double y, const double z)
+{
+    double r[16];
+    quaternion::from_axis_angle(angle, x, y, z).to_matrix(r);
+    mult(r);
+    return;
+}
+
+void matrix_stack::scale(const double x, const double y, const double z)
+{
+    double* m = &current()[current().size()-16];
+    for(int i = 0; i < 4; i++)
+    {
+        m[i] *= x;
+        m[4+i] *= y;
+        m[8+i] *= z;
+    }
+    upload();
+    return;
+}
+
+void matrix_stack::ortho(const double left, const double right, const double bottom, const double top,
+                         const double near_val, const double far_val)
+{
+    double m[16];
+    identity_matrix(m);
+    m[0] = 2 / (right - left);
+    m[5] = 2 / (top - bottom);
+    m[10] = -2 / (far_val - near_val);
+    m[12] = -(right + left) / (right - left);
+    m[13] = -(top + bottom) / (top - bottom);
+    m[14] = -(far_val + near_val) / (far_val - near_val);
+    mult(m);
+    return;
+}
+
+void matrix_stack::perspective(const double fovy, const double aspect, const double z_near, const double z_far)
+{
+    double m[16];
+    double radians = fovy / 2 * M_PI / 180;
+    double cotangent = cos(radians) / sin(radians);
+    
+    identity_matrix(m);
+    m[0] = cotangent / aspect;
+    m[5] = cotangent;
+    m[10] = -(z_far + z_near) / (z_far - z_near);
+    m[11] = -1;
+    m[14] = -2 * z_near * z_far / (z_far - z_near);
+    m[15] = 0;
+    mult(m);
+    return;
+}
+
+const double* matrix_stack::top(const GLenum which) const
+{
+    const vector<double> & stack = which == GL_PROJECTION ? projection : modelview;
+    return &stack[stack.size()-16];
+}
+
+void matrix_stack::get(const GLenum which, double* m) const
+{
+    const double* t = top(which);
+    copy(t, t+16, m);
+    return;
+}
+
+void matrix_stack::upload()
+{
+    changes++;
+    if(fixed_function)
+        glLoadMatrixd(top(curr_mode));
+    return;
+}
@@ -0,0 +1,75 @@
+/*
+ *  matrix_stack.h
+ *  LorenzGL_verHY
+ *
+ *  Modelview and projection matrices kept on the CPU, so they can be read
+ *  without asking the GL; only the resulting matrices are sent to the GL.
+ *
+ */
+#ifndef MATRIX_STACK_H
+#define MATRIX_STACK_H
+
+#include <vector>
+#include <OpenGL/gl.h>
+
+using namespace std;
+
+// 4x4 matrices are column-major double[16], as in OpenGL
+void multiply_matrix(const double* a, const double* b, double* product); // product = a * b, may alias neither
+void identity_matrix(double* m);
+
+// unit quaternion w + xi + yj + zk
+struct quaternion
+{
+    double w, x, y, z;
+    
+    quaternion() : w(1), x(0), y(0), z(0) {}
+    quaternion(const double w, const double x, const double y, const double z) : w(w), x(x), y(y), z(z) {}
+    
+    // rotation by angle degrees around (ax, ay, az), counterclockwise as in glRotate
+    static quaternion from_axis_angle(const double angle, const double ax, const double ay, const double az);
+    quaternion operator*(const quaternion & q) const;
+    void to_matrix(double* m) const;
+};
+
+// same semantics as the GL matrix stacks (popping the last matrix is ignored),
+// every change loads the new top into the GL with glLoadMatrixd unless the
+// fixed-function matrices are off (core profile contexts have none)
+class matrix_stack
+{
+public:
+    matrix_stack();
+    
+    void mode(const GLenum new_mode); // GL_MODELVIEW or GL_PROJECTION
+    void push();
+    void pop();
+    void load_identity();
+    void load(const double* m);
+    void mult(const double* m);
+    void translate(const double x, const double y, const double z);
+    void rotate(const double angle, const double x, const double y, const double z);
+    void scale(const double x, const double y, const double z);
+    void ortho(const double left, const double right, const double bottom, const double top,
+               const double near_val, const double far_val);
+    void perspective(const double fovy, const double aspect, const double z_near, const double z_far);
+    
+    // top of the modelview or projection stack
+    const double* top(const GLenum which) const;
+    void get(const GLenum which, double* m) const;
+    
+    void set_fixed_function(const bool enabled) {fixed_function = enabled;}
+    // changes with every change of either top
+    unsigned long version() const {return changes;}
+    
+private:
+    vector<double> & current() {return curr_mode == GL_PROJECTION ? projection : modelview;}
+    void upload();
+    
+    vector<double> modelview;  // 16 values per matrix, top last
+    vector<double> projection;
+    GLenum curr_mode;
+    bool fixed_function;
+    unsigned long changes;
+};
+
+#endif
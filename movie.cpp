@@ -0,0 +1,210 @@
+/*
+ *  movie.cpp
+ *  LorenzGL_verHY
+ *
+ *  Renders the movie path without a window, one offscreen context and
+ *  attractor per thread; times the renderers the same way.
+ *
+ */
+
+#include "movie.h"
+#include "attractor.h"
+#include "offscreen.h"
+#include "parallel.h"
+#include <map>
+#include <ctime>
+#include <sys/time.h>
+
+struct movie_job
+{
+    string output_dir;
+    int num_frames;
+    double frame_step;
+    int width, height;
+    int num_points;
+    void (*init_gl)();
+    int num_threads;
+    bool core_profile;
+    bool failed;
+    
+    // attractor::init changes directory and logs, so contexts are set up one at a time
+    pthread_mutex_t setup_mutex;
+    
+    // streamed frames wait here until all earlier ones are written
+    int next_frame;
+    map<int, vector<unsigned char> > pending;
+    pthread_mutex_t mutex;
+    pthread_cond_t frame_written;
+};
+
+static bool stream_frame(movie_job* job, const int i, vector<unsigned char> & rgba)
+{
+    bool ok = true;
+    
+    pthread_mutex_lock(&job->mutex);
+    // bound the frames held back, the thread drawing next_frame never waits
+    while(i >= job->next_frame + 2*job->num_threads && !job->failed)
+        pthread_cond_wait(&job->frame_written, &job->mutex);
+    job->pending[i].swap(rgba);
+    while(!job->failed && !job->pending.empty() && job->pending.begin()->first == job->next_frame)
+    {
+        vector<unsigned char> & frame = job->pending.begin()->second;
+        if(fwrite(&frame[0], 1, frame.size(), stdout) != frame.size())
+        {
+            cerr << "ERROR (movie): cannot write frame " << job->next_frame << " to stdout.\n";
+            job->failed = true;
+        }
+        job->pending.erase(job->pending.begin());
+        job->next_frame++;
+    }
+    ok = !job->failed;
+    pthread_cond_broadcast(&job->frame_written);
+    pthread_mutex_unlock(&job->mutex);
+    return ok;
+}
+
+static void render_frames(const int t, void* arg)
+{
+    movie_job* job = (movie_job*) arg;
+    offscreen_context context;
+    attractor* a = NULL;
+    vector<unsigned char> rgba;
+    char filename[32];
+    double runtime;
+    bool ok;
+    
+    pthread_mutex_lock(&job->setup_mutex);
+    ok = !job->failed && context.create(job->width, job->height, job->core_profile);
+    if(ok)
+    {
+        job->init_gl();
+        a = new attractor(job->num_points);
+        a->init(true);
+        a->set_view(1);
+        a->change_scale(min(job->width/800.0, job->height/600.0));
+        a->set_window_size(job->width, job->height);
+    }
+    pthread_mutex_unlock(&job->setup_mutex);
+    
+    for(int i = t; ok && i < job->num_frames; i += job->num_threads)
+    {
+        // no wall clock, every frame is the same function of its index
+        runtime = (i+1) * job->frame_step;
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        a->draw(runtime);
+        context.read_pixels(rgba);
+        
+        if(job->output_dir == "-")
+        {
+            ok = stream_frame(job, i, rgba);
+            continue;
+        }
+        snprintf(filename, sizeof(filename), "/frame_%05d.png", i);
+        if(!write_png(job->output_dir + filename, job->width, job->height, rgba))
+        {
+            cerr << "ERROR (movie): cannot write " << job->output_dir + filename << ".\n";
+            ok = false;
+        }
+        ok = ok && !job->failed;
+    }
+    
+    pthread_mutex_lock(&job->mutex);
+    job->failed = job->failed || !ok;
+    pthread_cond_broadcast(&job->frame_written);
+    pthread_mutex_unlock(&job->mutex);
+    
+    delete a;
+    return;
+}
+
+bool export_movie(const string output_dir, const int num_frames, const double frame_step,
+                  const int width, const int height, const int num_points,
+                  void (*init_gl)(), int num_threads, const bool core_profile)
+{
+    movie_job job;
+    
+    if(num_threads <= 0)
+        num_threads = num_cores();
+    if(num_threads > num_frames)
+        num_threads = num_frames;
+    
+    job.output_dir = output_dir;
+    job.num_frames = num_frames;
+    job.frame_step = frame_step;
+    job.width = width;
+    job.height = height;
+    job.num_points = num_points;
+    job.init_gl = init_gl;
+    job.num_threads = num_threads;
+    job.core_profile = core_profile;
+    job.failed = false;
+    job.next_frame = 0;
+    pthread_mutex_init(&job.setup_mutex, NULL);
+    pthread_mutex_init(&job.mutex, NULL);
+    pthread_cond_init(&job.frame_written, NULL);
+    
+    parallel_for(num_threads, render_frames, &job, num_threads);
+    
+    pthread_cond_destroy(&job.frame_written);
+    pthread_mutex_destroy(&job.mutex);
+    pthread_mutex_destroy(&job.setup_mutex);
+    if(output_dir == "-")
+        fflush(stdout);
+    return !job.failed;
+}
+
+static double wall_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+bool renderer_benchmark(ostream & out, const int num_frames, const int width, const int height,
+                        const int num_points, void (*init_gl)())
+{
+    const int num_views = 9;
+    const char* names[2] = {"legacy", "core"};
+    double wall[2][num_views+1], cpu[2][num_views+1];
+    double runtime, t0, c0;
+    
+    for(int profile = 0; profile < 2; profile++)
+    {
+        offscreen_context context;
+        if(!context.create(width, height, profile == 1))
+            return false;
+        init_gl();
+        attractor* a = new attractor(num_points);
+        a->init(false);
+        a->change_scale(min(width/800.0, height/600.0));
+        a->set_window_size(width, height);
+        
+        // the same frames for both, once around to warm up the caches and lists
+        for(int view = 1; view <= num_views; view++)
+        {
+            a->set_view(view);
+            runtime = num_points / 2;
+            for(int i = 0; i < 5; i++)
+                a->draw(runtime);
+            glFinish();
+            t0 = wall_time();
+            c0 = double(clock()) / CLOCKS_PER_SEC;
+            for(int i = 0; i < num_frames; i++)
+            {
+                runtime += 1;
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                a->draw(runtime);
+                glFinish();
+            }
+            wall[profile][view] = 1000 * (wall_time() - t0) / num_frames;
+            cpu[profile][view] = 1000 * (double(clock()) / CLOCKS_PER_SEC - c0) / num_frames;
+            cerr << names[profile] << " view " << view << ": " << wall[profile][view] << " ms\n";
+        }
+        delete a;
+    }
+    
+    out << "view,legacy_ms,core_ms,legacy_cpu_ms,core_cpu_ms\n";
+    for(int view = 1; view <= num_views; view++)
+        out << view << "," << wall[0][view] << "," << wall[1][view] << "," << cpu[0][view] << "," << cpu[1][view] << "\n";
+    return true;
+}
@@ -0,0 +1,31 @@
+/*
+ *  movie.h
+ *  LorenzGL_verHY
+ *
+ *  Renders the movie path without a window, one offscreen context and
+ *  attractor per thread; times the renderers the same way.
+ *
+ */
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+// frame i of [0, num_frames) is drawn at time (i+1)*frame_step into
+// output_dir/frame_00000.png ..., or streamed in order as raw top-down RGBA to
+// stdout if output_dir is -; thread t draws frames t, t+num_threads, ... so the
+// frames do not depend on the number of threads (0 = all cores).
+// init_gl sets up the GL state of each new context, a core profile one if core_profile.
+bool export_movie(const string output_dir, const int num_frames, const double frame_step,
+                  const int width, const int height, const int num_points,
+                  void (*init_gl)(), int num_threads = 0, const bool core_profile = false);
+
+// draws num_frames frames of every view offscreen with the legacy and the core
+// profile renderer and prints the wall and cpu ms per frame of each as csv
+bool renderer_benchmark(ostream & out, const int num_frames, const int width, const int height,
+                        const int num_points, void (*init_gl)());
+
+#endif
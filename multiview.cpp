@@ -0,0 +1,227 @@
+/*
+ *  multiview.cpp
+ *  LorenzGL_verHY
+ *
+ *  Multiview embedding: forecasts averaged over the best of all mixed
+ *  variable/lag embeddings.
+ *
+ */
+
+#include "multiview.h"
+#include "parallel.h"
+#include <algorithm>
+
+struct view_order
+{
+    const vector<embedding_view>* views;
+    bool operator()(const int a, const int b) const {return (*views)[a].skill > (*views)[b].skill;}
+};
+
+multiview::multiview(const vector<vector<double> > & series, const int target, const int E,
+                     const int max_lag, const int tau, const int tp, const int nn_skip) : series(series)
+{
+    int n = series[0].size();
+    int num_coords = series.size() * max_lag;
+    vector<int> choice(E);
+    double mean, var;
+
+    this->target = target;
+    this->E = E;
+    this->tau = tau;
+    this->tp = tp;
+    this->nn_skip = nn_skip;
+    skill = 0;
+
+    // one normalized copy shared by all views
+    normalized.resize(series.size());
+    for(int v = 0; v < series.size(); v++)
+    {
+        mean = 0;
+        var = 0;
+        for(int i = 0; i < n; i++)
+            mean += series[v][i];
+        mean /= n;
+        for(int i = 0; i < n; i++)
+            var += (series[v][i] - mean) * (series[v][i] - mean);
+        var = (var > 0) ? sqrt(var / n) : 1;
+        normalized[v].resize(n);
+        for(int i = 0; i < n; i++)
+            normalized[v][i] = (series[v][i] - mean) / var;
+    }
+
+    // all views share rows, so every one starts at the largest lag
+    start = (max_lag-1)*tau;
+    first = start + (E+1)*nn_skip + tp;
+    split = first + (n - first) / 2;
+
+    // coordinate c is variable c / max_lag at lag c % max_lag, choose E of them
+    if(E > num_coords)
+        return;
+    for(int e = 0; e < E; e++)
+        choice[e] = e;
+    while(true)
+    {
+        embedding_view view;
+        bool unlagged = false;
+        for(int e = 0; e < E; e++)
+        {
+            view.vars.push_back(choice[e] / max_lag);
+            view.lags.push_back(choice[e] % max_lag);
+            unlagged = unlagged || view.lags[e] == 0;
+        }
+        view.skill = 0;
+        if(unlagged)
+        {
+            // combinations in lexicographic order keep each first three coordinates together
+            if(views.empty() || E <= 3 || choice[0] != views.back().vars[0] * max_lag + views.back().lags[0] ||
+               choice[1] != views.back().vars[1] * max_lag + views.back().lags[1] ||
+               choice[2] != views.back().vars[2] * max_lag + views.back().lags[2])
+                group_start.push_back(views.size());
+            views.push_back(view);
+        }
+
+        // next combination in lexicographic order
+        int e = E-1;
+        while(e >= 0 && choice[e] == num_coords - E + e)
+            e--;
+        if(e < 0)
+            break;
+        choice[e]++;
+        for(e++; e < E; e++)
+            choice[e] = choice[e-1] + 1;
+    }
+    group_start.push_back(views.size());
+}
+
+void multiview::columns(const embedding_view & view, vector<const double*> & cols) const
+{
+    cols.resize(view.vars.size());
+    for(int e = 0; e < cols.size(); e++)
+        cols[e] = &normalized[view.vars[e]][start - view.lags[e]*tau];
+    return;
+}
+
+void multiview::predict(const embedding_view & view, vector<double> & pred, const nn_grid* grid) const
+{
+    const vector<double> & ts = series[target];
+    int n = ts.size();
+    vector<const double*> cols;
+    nn_table table;
+
+    pred.assign(n, 0);
+    if(n <= start)
+        return;
+    columns(view, cols);
+    if(grid)
+        build_nn_table(cols, n, start, E+1, nn_skip, table, *grid);
+    else
+        build_nn_table(cols, n, start, E+1, nn_skip, table);
+
+    for(int row = 0; row < table.order.size(); row++)
+    {
+        const int t = table.order[row];
+        const int* nn_indices = &table.indices[t*(E+1)];
+        const double* nn_weights = &table.weights[t*(E+1)];
+        double p = 0;
+        if(t + tp >= n)
+            continue;
+        for(int i = 0; i <= E; i++)
+            p += ts[nn_indices[i] + tp] * nn_weights[i];
+        pred[t + tp] = p;
+    }
+    return;
+}
+
+void multiview::score_views(const int g, void* arg)
+{
+    multiview* m = (multiview*) arg;
+    int n = m->series[0].size();
+    vector<const double*> cols;
+    vector<double> pred;
+    nn_grid* grid = NULL;
+
+    // one grid over the coordinates the views of the group have in common
+    if(n > m->start)
+    {
+        m->columns(m->views[m->group_start[g]], cols);
+        cols.resize(min(m->E, 3));
+        grid = new nn_grid(cols, n, m->start, m->nn_skip);
+    }
+    for(int v = m->group_start[g]; v < m->group_start[g+1]; v++)
+    {
+        m->predict(m->views[v], pred, grid);
+        m->views[v].skill = pearson(pred, m->series[m->target], m->first, m->split);
+    }
+    delete grid;
+    return;
+}
+
+void multiview::predict_view(const int i, void* arg)
+{
+    multiview* m = (multiview*) arg;
+    m->predict(m->views[m->ranking[i]], m->top_predictions[i]);
+    return;
+}
+
+void multiview::compute(const int num_top, const int num_threads)
+{
+    int n = series[0].size();
+    int k = num_top;
+    view_order by_skill;
+
+    for(int i = 1; i < series.size(); i++)
+    {
+        if(series[i].size() != n)
+        {
+            cerr << "ERROR (multiview): series " << i << " has " << series[i].size()
+                 << " points, expected " << n << ".\n";
+            exit(1);
+        }
+    }
+
+    // score every view on the first half, keeping only its skill
+    parallel_for(group_start.size() - 1, score_views, this, num_threads);
+
+    ranking.resize(views.size());
+    for(int v = 0; v < views.size(); v++)
+        ranking[v] = v;
+    by_skill.views = &views;
+    stable_sort(ranking.begin(), ranking.end(), by_skill);
+
+    if(k <= 0)
+        k = int(sqrt(double(views.size())));
+    if(k < 1)
+        k = 1;
+    if(k > views.size())
+        k = views.size();
+    ranking.resize(k);
+
+    // redo the forecasts of the best views, cheaper than storing all of them
+    top_predictions.resize(k);
+    parallel_for(k, predict_view, this, num_threads);
+
+    forecast.assign(n, 0);
+    for(int i = 0; i < k; i++)
+    {
+        for(int t = first; t < n; t++)
+            forecast[t] += top_predictions[i][t] / k;
+    }
+    skill = pearson(forecast, series[target], split, n);
+    top_predictions.clear();
+    return;
+}
+
+void multiview::write(ostream & out) const
+{
+    out << "skill,embedding\n";
+    out << skill << ",ensemble of " << ranking.size() << " / " << views.size() << " views\n";
+    for(int i = 0; i < ranking.size(); i++)
+    {
+        const embedding_view & view = views[ranking[i]];
+        out << view.skill << ",";
+        for(int e = 0; e < E; e++)
+            out << (e > 0 ? " " : "") << "v" << view.vars[e] << "(t-" << view.lags[e]*tau << ")";
+        out << "\n";
+    }
+    return;
+}
@@ -0,0 +1,66 @@
+/*
+ *  multiview.h
+ *  LorenzGL_verHY
+ *
+ *  Multiview embedding: forecasts averaged over the best of all mixed
+ *  variable/lag embeddings.
+ *
+ */
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include "ccm.h"
+
+using namespace std;
+
+// one mixed embedding, coordinate e is series[vars[e]] lagged by lags[e]*tau
+struct embedding_view
+{
+    vector<int> vars;
+    vector<int> lags;
+    double skill; // forecast skill over the first half of the forecasts
+};
+
+class multiview
+{
+public:
+    // every E-dimensional combination of (variable, lag < max_lag) with at least one
+    // unlagged coordinate is a view; each forecasts series[target] tp steps ahead
+    multiview(const vector<vector<double> > & series, const int target, const int E,
+              const int max_lag, const int tau, const int tp, const int nn_skip);
+
+    // rank the views by skill and average the num_top best, sqrt(number of views) if 0
+    void compute(const int num_top = 0, const int num_threads = 0);
+
+    // ensemble forecast indexed by the forecasted time, 0 where undefined
+    const vector<double> & get_forecast() const {return forecast;}
+    // ensemble skill over the second half of the forecasts, not used for ranking
+    double get_skill() const {return skill;}
+    int num_views() const {return views.size();}
+    void write(ostream & out) const;
+
+private:
+    static void score_views(const int g, void* arg);
+    static void predict_view(const int i, void* arg);
+    void predict(const embedding_view & view, vector<double> & pred, const nn_grid* grid = NULL) const;
+    void columns(const embedding_view & view, vector<const double*> & cols) const;
+
+    const vector<vector<double> > & series;
+    vector<vector<double> > normalized; // zero mean, unit variance, so views mix variables fairly
+    int target;
+    int E;
+    int tau;
+    int tp;
+    int nn_skip;
+    int start;  // first time every view is defined
+    int first;  // first forecasted time
+    int split;  // forecasts before split rank the views, the rest score the ensemble
+    vector<embedding_view> views;
+    vector<int> group_start; // views [group_start[g], group_start[g+1]) share their first three coordinates
+    vector<int> ranking;
+    vector<vector<double> > top_predictions;
+    vector<double> forecast;
+    double skill;
+};
+
+#endif
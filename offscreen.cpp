@@ -0,0 +1,187 @@
+/*
+ *  offscreen.cpp
+ *  LorenzGL_verHY
+ *
+ *  GL context rendering into a framebuffer object without a window or a
+ *  display server, for exporting frames on machines without either.
+ *
+ */
+
+#include "offscreen.h"
+#include <iostream>
+#include <algorithm>
+#include "/usr/X11/include/png.h"
+#ifndef __APPLE__
+#include <EGL/eglext.h>
+#endif
+
+offscreen_context::offscreen_context()
+{
+    width = 0;
+    height = 0;
+    framebuffer = 0;
+    context = NULL;
+#ifndef __APPLE__
+    display = EGL_NO_DISPLAY;
+#endif
+}
+
+offscreen_context::~offscreen_context()
+{
+    if(context == NULL)
+        return;
+    make_current();
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+#ifdef __APPLE__
+    CGLSetCurrentContext(NULL);
+    CGLDestroyContext(context);
+#else
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+#endif
+}
+
+bool offscreen_context::create(const int width, const int height, const bool core_profile)
+{
+    this->width = width;
+    this->height = height;
+
+#ifdef __APPLE__
+    // the generic renderer runs on the CPU, like the render farm nodes
+    CGLPixelFormatAttribute attributes[] = {kCGLPFARendererID, (CGLPixelFormatAttribute) kCGLRendererGenericFloatID,
+                                            kCGLPFAOpenGLProfile, (CGLPixelFormatAttribute) kCGLOGLPVersion_Legacy,
+                                            (CGLPixelFormatAttribute) 0};
+    if(core_profile)
+        attributes[3] = (CGLPixelFormatAttribute) kCGLOGLPVersion_3_2_Core;
+    CGLPixelFormatObj pixel_format;
+    GLint num_formats;
+    if(CGLChoosePixelFormat(attributes, &pixel_format, &num_formats) != kCGLNoError || pixel_format == NULL)
+    {
+        cerr << "ERROR (offscreen): no software renderer.\n";
+        return false;
+    }
+    CGLError error = CGLCreateContext(pixel_format, NULL, &context);
+    CGLDestroyPixelFormat(pixel_format);
+    if(error != kCGLNoError)
+    {
+        context = NULL;
+        cerr << "ERROR (offscreen): cannot create a context.\n";
+        return false;
+    }
+#else
+    // Mesa's surfaceless platform needs neither X nor a GPU
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLint major, minor;
+    if(get_platform_display != NULL)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        cerr << "ERROR (offscreen): no surfaceless EGL display.\n";
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+    // forward compatible like the core contexts of macOS
+    const EGLint core_attributes[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+                                      EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR, EGL_NONE};
+    context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, core_profile ? core_attributes : NULL);
+    if(context == EGL_NO_CONTEXT)
+    {
+        context = NULL;
+        cerr << "ERROR (offscreen): cannot create a context.\n";
+        return false;
+    }
+#endif
+    make_current();
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        cerr << "ERROR (offscreen): incomplete " << width << " x " << height << " framebuffer.\n";
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+void offscreen_context::make_current()
+{
+#ifdef __APPLE__
+    CGLSetCurrentContext(context);
+#else
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+#endif
+    return;
+}
+
+void offscreen_context::read_pixels(vector<unsigned char> & rgba)
+{
+    int row_size = 4*width;
+    vector<unsigned char> row(row_size);
+
+    rgba.resize(row_size*height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+
+    // the GL returns the bottom row first
+    for(int i = 0; i < height/2; i++)
+    {
+        unsigned char* top = &rgba[i*row_size];
+        unsigned char* bottom = &rgba[(height-1-i)*row_size];
+        copy(top, top+row_size, row.begin());
+        copy(bottom, bottom+row_size, top);
+        copy(row.begin(), row.end(), bottom);
+    }
+    return;
+}
+
+bool write_png(const string filename, const int width, const int height, const vector<unsigned char> & rgba)
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+
+    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (!png_ptr) {
+        fclose(fp);
+        return false;
+    }
+    png_infop info_ptr = png_create_info_struct(png_ptr);
+    if (!info_ptr) {
+        png_destroy_write_struct(&png_ptr, (png_infopp) NULL);
+        fclose(fp);
+        return false;
+    }
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        return false;
+    }
+
+    png_init_io(png_ptr, fp);
+    // frames are encoded once and read once, favor speed over size
+    png_set_compression_level(png_ptr, 1);
+    png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png_ptr, info_ptr);
+    // the cleared background has alpha 0, drop the alpha channel
+    png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
+    for(int i = 0; i < height; i++)
+        png_write_row(png_ptr, (png_bytep) &rgba[4*width*i]);
+    png_write_end(png_ptr, NULL);
+
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,57 @@
+/*
+ *  offscreen.h
+ *  LorenzGL_verHY
+ *
+ *  GL context rendering into a framebuffer object without a window or a
+ *  display server, for exporting frames on machines without either.
+ *
+ */
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <OpenGL/gl.h>
+#ifdef __APPLE__
+#include <OpenGL/OpenGL.h>
+#else
+#include <EGL/egl.h>
+#endif
+
+using namespace std;
+
+class offscreen_context
+{
+public:
+    offscreen_context();
+    ~offscreen_context();
+
+    // software rendered context with a width x height color and depth buffer,
+    // current on the calling thread, an OpenGL 3.2+ core profile one if core_profile;
+    // false if the platform cannot provide one
+    bool create(const int width, const int height, const bool core_profile = false);
+    void make_current();
+
+    // rows top first, 4 bytes per pixel
+    void read_pixels(vector<unsigned char> & rgba);
+
+    int get_width() const {return width;}
+    int get_height() const {return height;}
+
+private:
+    int width, height;
+    GLuint framebuffer;
+    GLuint renderbuffers[2]; // color, depth
+#ifdef __APPLE__
+    CGLContextObj context;
+#else
+    EGLDisplay display;
+    EGLContext context;
+#endif
+};
+
+// rows top first, 4 bytes per pixel of which alpha is dropped
+bool write_png(const string filename, const int width, const int height, const vector<unsigned char> & rgba);
+
+#endif
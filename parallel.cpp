@@ -0,0 +1,79 @@
+/*
+ *  parallel.cpp
+ *  LorenzGL_verHY
+ *
+ *  Simple pthread work sharing for the offline analyses.
+ *
+ */
+
+#include "parallel.h"
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+struct parallel_job
+{
+    int n;
+    int next;
+    void (*body)(const int i, void* arg);
+    void* arg;
+    pthread_mutex_t mutex;
+};
+
+static void* parallel_worker(void* arg)
+{
+    parallel_job* job = (parallel_job*) arg;
+    int i;
+
+    while(true)
+    {
+        pthread_mutex_lock(&job->mutex);
+        i = job->next++;
+        pthread_mutex_unlock(&job->mutex);
+        if(i >= job->n)
+            break;
+        job->body(i, job->arg);
+    }
+    return NULL;
+}
+
+int num_cores()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if(n < 1)
+        return 1;
+    return int(n);
+}
+
+void parallel_for(const int n, void (*body)(const int i, void* arg), void* arg, int num_threads)
+{
+    parallel_job job;
+    vector<pthread_t> threads;
+
+    if(num_threads <= 0)
+        num_threads = num_cores();
+    if(num_threads > n)
+        num_threads = n;
+
+    job.n = n;
+    job.next = 0;
+    job.body = body;
+    job.arg = arg;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    // the calling thread works too
+    for(int t = 1; t < num_threads; t++)
+    {
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, parallel_worker, &job) == 0)
+            threads.push_back(thread);
+    }
+    parallel_worker(&job);
+
+    for(int t = 0; t < threads.size(); t++)
+        pthread_join(threads[t], NULL);
+
+    pthread_mutex_destroy(&job.mutex);
+    return;
+}
@@ -0,0 +1,20 @@
+/*
+ *  parallel.h
+ *  LorenzGL_verHY
+ *
+ *  Simple pthread work sharing for the offline analyses.
+ *
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <pthread.h>
+
+// number of online processors (at least 1)
+int num_cores();
+
+// calls body(i, arg) for i in [0, n) on num_threads threads (0 = all cores)
+// items are handed out one at a time, so uneven item costs balance out
+void parallel_for(const int n, void (*body)(const int i, void* arg), void* arg, int num_threads = 0);
+
+#endif
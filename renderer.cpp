@@ -0,0 +1,1060 @@
+/*
+ *  renderer.cpp
+ *  LorenzGL_verHY
+ *
+ *  How the drawing code reaches the GL: the fixed-function pipeline the
+ *  program was written for, or buffers and shaders in a core profile context.
+ *
+ */
+
+#ifdef __APPLE__
+#define GL_DO_NOT_WARN_IF_MULTI_GL_VERSION_HEADERS_INCLUDED
+#include <OpenGL/gl3.h>
+#endif
+#include "renderer.h"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <math.h>
+#include "hud_font.h"
+
+#define STREAM_BUFFER_SIZE (4 << 20) // bytes of immediate mode and client array vertices per orphaning
+#define CORE_VERTEX_SIZE 9           // floats per immediate mode vertex
+
+// the shader dialect of renderer.h on GLSL 1.20 and the fixed-function state
+static const char* legacy_vertex_header =
+    "#version 120\n"
+    "#define position (gl_Vertex.xyz)\n"
+    "#define color gl_Color\n"
+    "#define tex_coord (gl_MultiTexCoord0.st)\n"
+    "#define projection_modelview gl_ModelViewProjectionMatrix\n"
+    "#define vertex_color gl_FrontColor\n";
+
+static const char* legacy_fragment_shader =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = gl_Color;\n"
+    "}\n";
+
+// and on GLSL 3.30; sizes are in pixels
+static const char* core_vertex_header =
+    "#version 330 core\n"
+    "layout(std140) uniform transform\n"
+    "{\n"
+    "    mat4 projection_modelview;\n"
+    "    vec2 viewport;\n"
+    "    float line_width;\n"
+    "    float point_size;\n"
+    "};\n"
+    "layout(location = 0) in vec3 position;\n"
+    "layout(location = 1) in vec4 color;\n"
+    "layout(location = 2) in vec2 tex_coord;\n"
+    "out vec4 vertex_color;\n"
+    "out vec2 vertex_tex_coord;\n";
+
+static const char* core_vertex_shader =
+    "void main()\n"
+    "{\n"
+    "    gl_Position = projection_modelview * vec4(position, 1.0);\n"
+    "    vertex_color = color;\n"
+    "    vertex_tex_coord = tex_coord;\n"
+    "}\n";
+
+// quads around each line or point, one pixel wider for the smoothed edge;
+// edge is the distance from the line's center or the point's center in pixels
+static const char* core_geometry_shader =
+    "#version 330 core\n"
+    "layout(std140) uniform transform\n"
+    "{\n"
+    "    mat4 projection_modelview;\n"
+    "    vec2 viewport;\n"
+    "    float line_width;\n"
+    "    float point_size;\n"
+    "};\n"
+    "in vec4 vertex_color[];\n"
+    "in vec2 vertex_tex_coord[];\n"
+    "out vec4 fragment_color;\n"
+    "out vec2 fragment_tex_coord;\n"
+    "noperspective out vec2 edge;\n"
+    "#ifdef LINES\n"
+    "layout(lines) in;\n"
+    "layout(triangle_strip, max_vertices = 4) out;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 a = gl_in[0].gl_Position.xy / gl_in[0].gl_Position.w * viewport;\n"
+    "    vec2 b = gl_in[1].gl_Position.xy / gl_in[1].gl_Position.w * viewport;\n"
+    "    vec2 along = length(b - a) > 0.0 ? normalize(b - a) : vec2(1.0, 0.0);\n"
+    "    vec2 across = vec2(-along.y, along.x);\n"
+    "    float half_width = max(line_width, 1.0) / 2.0 + 0.5;\n"
+    "    for(int i = 0; i < 2; i++)\n"
+    "    {\n"
+    "        for(int side = -1; side <= 1; side += 2)\n"
+    "        {\n"
+    "            vec2 offset = across * (side * half_width);\n"
+    "            gl_Position = gl_in[i].gl_Position + vec4(2.0 * offset / viewport * gl_in[i].gl_Position.w, 0.0, 0.0);\n"
+    "            fragment_color = vertex_color[i];\n"
+    "            fragment_tex_coord = vertex_tex_coord[i];\n"
+    "            edge = vec2(side * half_width, 0.0);\n"
+    "            EmitVertex();\n"
+    "        }\n"
+    "    }\n"
+    "    EndPrimitive();\n"
+    "}\n"
+    "#else\n"
+    "layout(points) in;\n"
+    "layout(triangle_strip, max_vertices = 4) out;\n"
+    "void main()\n"
+    "{\n"
+    "    float half_size = point_size / 2.0 + 0.5;\n"
+    "    for(int i = 0; i < 4; i++)\n"
+    "    {\n"
+    "        vec2 offset = vec2(i % 2 == 0 ? -half_size : half_size, i < 2 ? -half_size : half_size);\n"
+    "        gl_Position = gl_in[0].gl_Position + vec4(2.0 * offset / viewport * gl_in[0].gl_Position.w, 0.0, 0.0);\n"
+    "        fragment_color = vertex_color[0];\n"
+    "        fragment_tex_coord = vertex_tex_coord[0];\n"
+    "        edge = offset;\n"
+    "        EmitVertex();\n"
+    "    }\n"
+    "    EndPrimitive();\n"
+    "}\n"
+    "#endif\n";
+
+// coverage of the smoothed edge, as GL_LINE_SMOOTH and GL_POINT_SMOOTH did;
+// lines are at least a pixel wide
+static const char* core_fragment_shader =
+    "#version 330 core\n"
+    "layout(std140) uniform transform\n"
+    "{\n"
+    "    mat4 projection_modelview;\n"
+    "    vec2 viewport;\n"
+    "    float line_width;\n"
+    "    float point_size;\n"
+    "};\n"
+    "uniform sampler2D sampler;\n"
+    "uniform bool textured;\n"
+    "#ifdef TRIANGLES\n"
+    "in vec4 vertex_color;\n"
+    "in vec2 vertex_tex_coord;\n"
+    "#define fragment_color vertex_color\n"
+    "#define fragment_tex_coord vertex_tex_coord\n"
+    "#else\n"
+    "in vec4 fragment_color;\n"
+    "in vec2 fragment_tex_coord;\n"
+    "noperspective in vec2 edge;\n"
+    "#endif\n"
+    "out vec4 frag_color;\n"
+    "void main()\n"
+    "{\n"
+    "    frag_color = fragment_color;\n"
+    "#ifdef LINES\n"
+    "    frag_color.a *= clamp(max(line_width, 1.0) / 2.0 + 0.5 - abs(edge.x), 0.0, 1.0);\n"
+    "#endif\n"
+    "#ifdef POINTS\n"
+    "    frag_color.a *= clamp(point_size / 2.0 + 0.5 - length(edge), 0.0, 1.0);\n"
+    "#endif\n"
+    "    if(textured)\n"
+    "        frag_color *= texture(sampler, fragment_tex_coord);\n"
+    "}\n";
+
+// markers: a quad per instance around a position already in normalized device
+// coordinates, the corners from gl_VertexID, covered as the POINTS fragment shader
+static const char* core_marker_vertex_shader =
+    "#version 330 core\n"
+    "layout(std140) uniform transform\n"
+    "{\n"
+    "    mat4 projection_modelview;\n"
+    "    vec2 viewport;\n"
+    "    float line_width;\n"
+    "    float point_size;\n"
+    "};\n"
+    "layout(location = 3) in vec3 marker_position;\n"
+    "layout(location = 4) in vec4 marker_color;\n"
+    "layout(location = 5) in float marker_size;\n"
+    "out vec4 fragment_color;\n"
+    "flat out float radius;\n"
+    "noperspective out vec2 edge;\n"
+    "void main()\n"
+    "{\n"
+    "    float half_size = marker_size / 2.0 + 0.5;\n"
+    "    vec2 offset = vec2(gl_VertexID % 2 == 0 ? -half_size : half_size, gl_VertexID < 2 ? -half_size : half_size);\n"
+    "    gl_Position = vec4(marker_position.xy + 2.0 * offset / viewport, marker_position.z, 1.0);\n"
+    "    fragment_color = marker_color;\n"
+    "    radius = half_size;\n"
+    "    edge = offset;\n"
+    "}\n";
+
+static const char* core_marker_fragment_shader =
+    "#version 330 core\n"
+    "in vec4 fragment_color;\n"
+    "flat in float radius;\n"
+    "noperspective in vec2 edge;\n"
+    "out vec4 frag_color;\n"
+    "void main()\n"
+    "{\n"
+    "    frag_color = fragment_color;\n"
+    "    frag_color.a *= clamp(radius - length(edge), 0.0, 1.0);\n"
+    "}\n";
+
+static const char* primitive_defines[3] = {"#define LINES\n", "#define POINTS\n", "#define TRIANGLES\n"};
+
+// stages joined from their pieces; 0 and the logs on cerr if it does not build
+static GLuint build_program(const int num_stages, const GLenum* types, const char** sources[], const int* num_sources)
+{
+    GLuint shaders[3], program;
+    GLint status;
+    char log[1024];
+
+    program = glCreateProgram();
+    for(int i = 0; i < num_stages; i++)
+    {
+        shaders[i] = glCreateShader(types[i]);
+        glShaderSource(shaders[i], num_sources[i], sources[i], NULL);
+        glCompileShader(shaders[i]);
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+        if(!status)
+        {
+            glGetShaderInfoLog(shaders[i], sizeof(log), NULL, log);
+            cerr << log;
+        }
+        glAttachShader(program, shaders[i]);
+    }
+    glLinkProgram(program);
+
+    // the program keeps the shaders until it is deleted
+    for(int i = 0; i < num_stages; i++)
+        glDeleteShader(shaders[i]);
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(!status)
+    {
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        cerr << log;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool core_profile_context()
+{
+    GLint profile = 0;
+    int gl_major = 0, gl_minor = 0;
+    const char* gl_version = (const char*) glGetString(GL_VERSION);
+
+    // only 3.2 and later contexts have profiles
+    if(gl_version != NULL)
+        sscanf(gl_version, "%d.%d", &gl_major, &gl_minor);
+    if(gl_major > 3 || (gl_major == 3 && gl_minor >= 2))
+        glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+    return (profile & GL_CONTEXT_CORE_PROFILE_BIT) != 0;
+}
+
+renderer* create_renderer(matrix_stack & matrices)
+{
+    if(!core_profile_context())
+        return new legacy_renderer();
+
+    core_renderer* core = new core_renderer(matrices);
+    if(!core->init())
+    {
+        cerr << "ERROR (renderer): could not build the core profile shaders.\n";
+        exit(1);
+    }
+    matrices.set_fixed_function(false);
+    return core;
+}
+
+// ***** LEGACY RENDERER *****
+
+legacy_renderer::legacy_renderer()
+{
+    for(int i = 0; i < 3; i++)
+        arrays[i] = false;
+}
+
+legacy_renderer::~legacy_renderer()
+{
+}
+
+void legacy_renderer::begin(const GLenum mode)
+{
+    glBegin(mode);
+    return;
+}
+
+void legacy_renderer::end()
+{
+    glEnd();
+    return;
+}
+
+void legacy_renderer::vertex(const double x, const double y, const double z)
+{
+    glVertex3d(x, y, z);
+    return;
+}
+
+void legacy_renderer::color(const double r, const double g, const double b, const double a)
+{
+    glColor4d(r, g, b, a);
+    return;
+}
+
+void legacy_renderer::tex_coord(const double s, const double t)
+{
+    glTexCoord2d(s, t);
+    return;
+}
+
+void legacy_renderer::line_width(const double width)
+{
+    glLineWidth(width);
+    return;
+}
+
+void legacy_renderer::point_size(const double size)
+{
+    glPointSize(size);
+    return;
+}
+
+void legacy_renderer::texture(const GLuint texture)
+{
+    if(texture == 0)
+    {
+        glDisable(GL_TEXTURE_2D);
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glEnable(GL_TEXTURE_2D);
+    return;
+}
+
+void legacy_renderer::text(const double x, const double y, const string & s)
+{
+    GLint alignment;
+
+    // the core renderer's font, GLUT's bitmap fonts need a display
+    if(glyphs.empty())
+    {
+        glyphs.resize(2*HUD_FONT_HEIGHT*HUD_FONT_COUNT);
+        for(int g = 0; g < HUD_FONT_COUNT; g++)
+        {
+            for(int row = 0; row < HUD_FONT_HEIGHT; row++)
+            {
+                unsigned char* bytes = &glyphs[2*(g*HUD_FONT_HEIGHT + HUD_FONT_HEIGHT-1-row)];
+                bytes[0] = hud_font_rows[g][row] >> 8;
+                bytes[1] = hud_font_rows[g][row] & 0xff;
+            }
+        }
+    }
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glRasterPos2d(x, y);
+    for(int i = 0; i < s.size(); i++)
+    {
+        int g = (unsigned char) s[i] - HUD_FONT_FIRST;
+        if(g < 0 || g >= HUD_FONT_COUNT)
+            continue;
+        glBitmap(HUD_FONT_WIDTH, HUD_FONT_HEIGHT, HUD_FONT_ORIGIN, HUD_FONT_DESCENT, hud_font_advance[g], 0,
+                 &glyphs[2*g*HUD_FONT_HEIGHT]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    return;
+}
+
+GLuint legacy_renderer::begin_list()
+{
+    GLuint list = glGenLists(1);
+    glNewList(list, GL_COMPILE_AND_EXECUTE);
+    return list;
+}
+
+void legacy_renderer::end_list()
+{
+    glEndList();
+    return;
+}
+
+void legacy_renderer::call_list(const GLuint list)
+{
+    glCallList(list);
+    return;
+}
+
+void legacy_renderer::delete_list(const GLuint list)
+{
+    glDeleteLists(list, 1);
+    return;
+}
+
+void legacy_renderer::vertex_array(const GLuint buffer, const int size, const int stride, const void* pointer)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexPointer(size, GL_FLOAT, stride, pointer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    arrays[0] = true;
+    return;
+}
+
+void legacy_renderer::color_array(const GLuint buffer, const int size, const int stride, const void* pointer)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glColorPointer(size, GL_FLOAT, stride, pointer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableClientState(GL_COLOR_ARRAY);
+    arrays[1] = true;
+    return;
+}
+
+void legacy_renderer::tex_coord_array(const GLuint buffer, const int size, const int stride, const void* pointer)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glTexCoordPointer(size, GL_FLOAT, stride, pointer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    arrays[2] = true;
+    return;
+}
+
+void legacy_renderer::disable_arrays()
+{
+    const GLenum states[3] = {GL_VERTEX_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY};
+    for(int i = 0; i < 3; i++)
+    {
+        if(arrays[i])
+            glDisableClientState(states[i]);
+        arrays[i] = false;
+    }
+    return;
+}
+
+void legacy_renderer::draw_arrays(const GLenum mode, const int first, const int count)
+{
+    glDrawArrays(mode, first, count);
+    return;
+}
+
+void legacy_renderer::draw_elements(const GLenum mode, const GLuint index_buffer, const int first, const int count,
+                                    const int last_vertex)
+{
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glDrawElements(mode, count, GL_UNSIGNED_INT, (GLvoid*) (first*sizeof(GLuint)));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return;
+}
+
+void legacy_renderer::draw_markers(const vector<GLfloat> & markers)
+{
+    int count = markers.size() / 8;
+
+    if(count == 0)
+        return;
+    glVertexPointer(3, GL_FLOAT, 8*sizeof(GLfloat), &markers[0]);
+    glColorPointer(4, GL_FLOAT, 8*sizeof(GLfloat), &markers[3]);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    // the point size is not per vertex here, one draw per run of equal sizes
+    for(int first = 0, last; first < count; first = last)
+    {
+        for(last = first+1; last < count && markers[8*last+7] == markers[8*first+7]; last++)
+            ;
+        glPointSize(markers[8*first+7]);
+        glDrawArrays(GL_POINTS, first, last-first);
+    }
+
+    // the arrays set through vertex_array and color_array stay as they were
+    if(!arrays[0])
+        glDisableClientState(GL_VERTEX_ARRAY);
+    if(!arrays[1])
+        glDisableClientState(GL_COLOR_ARRAY);
+    return;
+}
+
+GLuint legacy_renderer::load_program(const char* vertex_source)
+{
+    const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    const char* vertex[2] = {legacy_vertex_header, vertex_source};
+    const char* fragment[1] = {legacy_fragment_shader};
+    const char** sources[2] = {vertex, fragment};
+    const int num_sources[2] = {2, 1};
+    return build_program(2, types, sources, num_sources);
+}
+
+void legacy_renderer::use_program(const GLuint program)
+{
+    glUseProgram(program);
+    return;
+}
+
+// ***** CORE RENDERER *****
+
+core_renderer::core_renderer(const matrix_stack & matrices) : matrices(matrices)
+{
+    width = 1;
+    height = 1;
+    vertex_array_object = 0;
+    stream_buffer = 0;
+    stream_offset = 0;
+    quad_index_buffer = 0;
+    num_quad_indices = 0;
+    transform_buffer = 0;
+    uploaded_version = 0;
+    uploaded_identity = false;
+    uploaded_sizes[0] = uploaded_sizes[1] = -1;
+    for(int i = 0; i < 3; i++)
+    {
+        programs[i] = 0;
+        arrays[i].enabled = false;
+    }
+    custom_program = 0;
+    current_program = 0;
+    marker_program = 0;
+    batch_mode = GL_POINTS;
+    current_color[0] = current_color[1] = current_color[2] = current_color[3] = 1;
+    current_tex_coord[0] = current_tex_coord[1] = 0;
+    current_line_width = 1;
+    current_point_size = 1;
+    current_texture = 0;
+    font_texture = 0;
+    recording = 0;
+}
+
+core_renderer::~core_renderer()
+{
+    for(int i = 0; i < lists.size(); i++)
+        glDeleteBuffers(1, &lists[i].buffer);
+    for(int i = 0; i < 3; i++)
+        glDeleteProgram(programs[i]);
+    glDeleteProgram(marker_program);
+    glDeleteTextures(1, &font_texture);
+    glDeleteBuffers(1, &stream_buffer);
+    glDeleteBuffers(1, &quad_index_buffer);
+    glDeleteBuffers(1, &transform_buffer);
+    glDeleteVertexArrays(1, &vertex_array_object);
+}
+
+bool core_renderer::init()
+{
+    vector<unsigned char> atlas(4*HUD_FONT_WIDTH*HUD_FONT_COUNT*HUD_FONT_HEIGHT, 255);
+    int atlas_width = HUD_FONT_WIDTH*HUD_FONT_COUNT;
+
+    for(int i = 0; i < 3; i++)
+    {
+        programs[i] = link_program(core_vertex_shader, primitive_class(i));
+        if(programs[i] == 0)
+            return false;
+        textured_location[i] = glGetUniformLocation(programs[i], "textured");
+    }
+    const GLenum marker_types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    const char** marker_sources[2] = {&core_marker_vertex_shader, &core_marker_fragment_shader};
+    const int marker_num_sources[2] = {1, 1};
+    marker_program = build_program(2, marker_types, marker_sources, marker_num_sources);
+    if(marker_program == 0)
+        return false;
+    glUniformBlockBinding(marker_program, glGetUniformBlockIndex(marker_program, "transform"), 0);
+
+    // every vertex goes through the one vertex array object
+    glGenVertexArrays(1, &vertex_array_object);
+    glBindVertexArray(vertex_array_object);
+    glGenBuffers(1, &stream_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, stream_buffer);
+    glBufferData(GL_ARRAY_BUFFER, STREAM_BUFFER_SIZE, NULL, GL_STREAM_DRAW);
+    glGenBuffers(1, &quad_index_buffer);
+    glGenBuffers(1, &transform_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, transform_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, 20*sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, transform_buffer);
+    // the marker attributes advance once per instance
+    for(int i = 3; i < 6; i++)
+        glVertexAttribDivisor(i, 1);
+
+    // white glyphs, covered pixels opaque
+    for(int g = 0; g < HUD_FONT_COUNT; g++)
+    {
+        for(int row = 0; row < HUD_FONT_HEIGHT; row++)
+        {
+            for(int column = 0; column < HUD_FONT_WIDTH; column++)
+            {
+                bool set = (hud_font_rows[g][row] >> (HUD_FONT_WIDTH-1-column)) & 1;
+                atlas[4*((HUD_FONT_HEIGHT-1-row)*atlas_width + g*HUD_FONT_WIDTH + column) + 3] = set ? 255 : 0;
+            }
+        }
+    }
+    glGenTextures(1, &font_texture);
+    glBindTexture(GL_TEXTURE_2D, font_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlas_width, HUD_FONT_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, &atlas[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+core_renderer::primitive_class core_renderer::classify(const GLenum mode)
+{
+    switch(mode)
+    {
+        case GL_LINES:
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP:
+            return LINE_PRIMITIVES;
+        case GL_POINTS:
+            return POINT_PRIMITIVES;
+        default:
+            return TRIANGLE_PRIMITIVES;
+    }
+}
+
+GLuint core_renderer::link_program(const char* vertex_source, const primitive_class primitives)
+{
+    const GLenum types[3] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+    const char* vertex[2] = {core_vertex_header, vertex_source};
+    const char* fragment[3] = {"#version 330 core\n", primitive_defines[primitives], core_fragment_shader};
+    const char* geometry[3] = {"#version 330 core\n", primitive_defines[primitives], core_geometry_shader};
+    const char** sources[3] = {vertex, fragment, geometry};
+    const int num_sources[3] = {2, 3, 3};
+    GLuint program;
+
+    // the shaders start with their own #version, the line after it goes first
+    fragment[2] = strchr(core_fragment_shader, '\n') + 1;
+    geometry[2] = strchr(core_geometry_shader, '\n') + 1;
+    program = build_program(primitives == TRIANGLE_PRIMITIVES ? 2 : 3, types, sources, num_sources);
+    if(program == 0)
+        return 0;
+    glUniformBlockBinding(program, glGetUniformBlockIndex(program, "transform"), 0);
+    return program;
+}
+
+void core_renderer::set_viewport(const int width, const int height)
+{
+    this->width = width;
+    this->height = height;
+    uploaded_sizes[0] = -1;
+    return;
+}
+
+void core_renderer::begin(const GLenum mode)
+{
+    batch_mode = mode;
+    batch.clear();
+    return;
+}
+
+void core_renderer::vertex(const double x, const double y, const double z)
+{
+    batch.push_back(x);
+    batch.push_back(y);
+    batch.push_back(z);
+    batch.insert(batch.end(), current_color, current_color+4);
+    batch.insert(batch.end(), current_tex_coord, current_tex_coord+2);
+    return;
+}
+
+void core_renderer::color(const double r, const double g, const double b, const double a)
+{
+    current_color[0] = r;
+    current_color[1] = g;
+    current_color[2] = b;
+    current_color[3] = a;
+    return;
+}
+
+void core_renderer::tex_coord(const double s, const double t)
+{
+    current_tex_coord[0] = s;
+    current_tex_coord[1] = t;
+    return;
+}
+
+void core_renderer::line_width(const double width)
+{
+    current_line_width = width;
+    return;
+}
+
+void core_renderer::point_size(const double size)
+{
+    current_point_size = size;
+    return;
+}
+
+void core_renderer::texture(const GLuint texture)
+{
+    current_texture = texture;
+    return;
+}
+
+void core_renderer::end()
+{
+    int count = batch.size() / CORE_VERTEX_SIZE;
+    GLintptr offset;
+
+    if(count == 0)
+        return;
+    if(recording != 0)
+    {
+        core_batch b = {batch_mode, int(recorded.size()) / CORE_VERTEX_SIZE, count,
+                        current_line_width, current_point_size, current_texture};
+        lists[recording-1].batches.push_back(b);
+        recorded.insert(recorded.end(), batch.begin(), batch.end());
+    }
+
+    offset = stream(&batch[0], batch.size()*sizeof(GLfloat));
+    for(int i = 0; i < 3; i++)
+    {
+        const int sizes[3] = {3, 4, 2};
+        const int starts[3] = {0, 3, 7};
+        glVertexAttribPointer(i, sizes[i], GL_FLOAT, GL_FALSE, CORE_VERTEX_SIZE*sizeof(GLfloat),
+                              (GLvoid*) (offset + starts[i]*sizeof(GLfloat)));
+        glEnableVertexAttribArray(i);
+    }
+    prepare(batch_mode, current_line_width, current_point_size, current_texture, false);
+    if(batch_mode == GL_QUADS)
+        draw_quads(0, count);
+    else
+        glDrawArrays(batch_mode, 0, count);
+    return;
+}
+
+void core_renderer::text(const double x, const double y, const string & s)
+{
+    const double* p = matrices.top(GL_PROJECTION);
+    const double* m = matrices.top(GL_MODELVIEW);
+    double pm[16], clip[4];
+    double pen_x, pen_y;
+
+    // the raster position in window pixels, as glRasterPos2d
+    multiply_matrix(p, m, pm);
+    for(int i = 0; i < 4; i++)
+        clip[i] = pm[i]*x + pm[4+i]*y + pm[12+i];
+    if(clip[3] <= 0)
+        return;
+    pen_x = floor((clip[0]/clip[3] + 1) / 2 * width + 0.5);
+    pen_y = floor((clip[1]/clip[3] + 1) / 2 * height + 0.5);
+
+    // one quad per glyph in normalized device coordinates
+    batch_mode = GL_QUADS;
+    batch.clear();
+    for(int i = 0; i < s.size(); i++)
+    {
+        int g = (unsigned char) s[i] - HUD_FONT_FIRST;
+        if(g < 0 || g >= HUD_FONT_COUNT)
+            continue;
+        double left = pen_x - HUD_FONT_ORIGIN, bottom = pen_y - HUD_FONT_DESCENT;
+        double corners[4][2] = {{0, 0}, {0, 1}, {1, 1}, {1, 0}};
+        for(int c = 0; c < 4; c++)
+        {
+            tex_coord(double(g + corners[c][0]) / HUD_FONT_COUNT, corners[c][1]);
+            vertex(2*(left + corners[c][0]*HUD_FONT_WIDTH) / width - 1, 2*(bottom + corners[c][1]*HUD_FONT_HEIGHT) / height - 1);
+        }
+        pen_x += hud_font_advance[g];
+    }
+    if(batch.empty())
+        return;
+
+    GLintptr offset = stream(&batch[0], batch.size()*sizeof(GLfloat));
+    for(int i = 0; i < 3; i++)
+    {
+        const int sizes[3] = {3, 4, 2};
+        const int starts[3] = {0, 3, 7};
+        glVertexAttribPointer(i, sizes[i], GL_FLOAT, GL_FALSE, CORE_VERTEX_SIZE*sizeof(GLfloat),
+                              (GLvoid*) (offset + starts[i]*sizeof(GLfloat)));
+        glEnableVertexAttribArray(i);
+    }
+    prepare(GL_QUADS, current_line_width, current_point_size, font_texture, true);
+    draw_quads(0, batch.size() / CORE_VERTEX_SIZE);
+    return;
+}
+
+GLuint core_renderer::begin_list()
+{
+    core_list l;
+
+    // reuse a deleted list
+    l.buffer = 0;
+    l.deleted = false;
+    for(recording = 1; recording <= lists.size(); recording++)
+    {
+        if(lists[recording-1].deleted)
+            break;
+    }
+    if(recording > lists.size())
+        lists.push_back(l);
+    else
+        lists[recording-1] = l;
+    recorded.clear();
+    return recording;
+}
+
+void core_renderer::end_list()
+{
+    core_list & l = lists[recording-1];
+
+    recording = 0;
+    if(recorded.empty())
+        return;
+    glGenBuffers(1, &l.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, l.buffer);
+    glBufferData(GL_ARRAY_BUFFER, recorded.size()*sizeof(GLfloat), &recorded[0], GL_STATIC_DRAW);
+    return;
+}
+
+void core_renderer::call_list(const GLuint list)
+{
+    const core_list & l = lists[list-1];
+
+    if(l.buffer == 0)
+        return;
+    glBindBuffer(GL_ARRAY_BUFFER, l.buffer);
+    for(int b = 0; b < l.batches.size(); b++)
+    {
+        const core_batch & batch = l.batches[b];
+        for(int i = 0; i < 3; i++)
+        {
+            const int sizes[3] = {3, 4, 2};
+            const int starts[3] = {0, 3, 7};
+            glVertexAttribPointer(i, sizes[i], GL_FLOAT, GL_FALSE, CORE_VERTEX_SIZE*sizeof(GLfloat),
+                                  (GLvoid*) ((batch.first*CORE_VERTEX_SIZE + starts[i])*sizeof(GLfloat)));
+            glEnableVertexAttribArray(i);
+        }
+        prepare(batch.mode, batch.line_width, batch.point_size, batch.texture, false);
+        if(batch.mode == GL_QUADS)
+            draw_quads(0, batch.count);
+        else
+            glDrawArrays(batch.mode, 0, batch.count);
+    }
+    return;
+}
+
+void core_renderer::delete_list(const GLuint list)
+{
+    core_list & l = lists[list-1];
+
+    glDeleteBuffers(1, &l.buffer);
+    l.buffer = 0;
+    l.batches.clear();
+    l.deleted = true;
+    return;
+}
+
+void core_renderer::vertex_array(const GLuint buffer, const int size, const int stride, const void* pointer)
+{
+    attribute_array a = {true, buffer, size, stride, pointer};
+    arrays[0] = a;
+    return;
+}
+
+void core_renderer::color_array(const GLuint buffer, const int size, const int stride, const void* pointer)
+{
+    attribute_array a = {true, buffer, size, stride, pointer};
+    arrays[1] = a;
+    return;
+}
+
+void core_renderer::tex_coord_array(const GLuint buffer, const int size, const int stride, const void* pointer)
+{
+    attribute_array a = {true, buffer, size, stride, pointer};
+    arrays[2] = a;
+    return;
+}
+
+void core_renderer::disable_arrays()
+{
+    for(int i = 0; i < 3; i++)
+        arrays[i].enabled = false;
+    return;
+}
+
+void core_renderer::bind_arrays(const int first, const int count)
+{
+    for(int i = 0; i < 3; i++)
+    {
+        const attribute_array & a = arrays[i];
+        if(!a.enabled)
+        {
+            // the current color and texture coordinates, as the fixed-function arrays
+            glDisableVertexAttribArray(i);
+            if(i == 1)
+                glVertexAttrib4fv(1, current_color);
+            else if(i == 2)
+                glVertexAttrib2fv(2, current_tex_coord);
+            continue;
+        }
+        if(a.buffer != 0)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, a.buffer);
+            glVertexAttribPointer(i, a.size, GL_FLOAT, GL_FALSE, a.stride, a.pointer);
+        }
+        else
+        {
+            // client memory up to the last vertex drawn
+            int stride = a.stride != 0 ? a.stride : a.size*sizeof(GLfloat);
+            GLintptr offset = stream(a.pointer, (first+count-1)*stride + a.size*sizeof(GLfloat));
+            glVertexAttribPointer(i, a.size, GL_FLOAT, GL_FALSE, stride, (GLvoid*) offset);
+        }
+        glEnableVertexAttribArray(i);
+    }
+    return;
+}
+
+void core_renderer::draw_arrays(const GLenum mode, const int first, const int count)
+{
+    if(count <= 0)
+        return;
+    bind_arrays(first, count);
+    prepare(mode, current_line_width, current_point_size, current_texture, false);
+    if(mode == GL_QUADS)
+        draw_quads(first, count);
+    else
+        glDrawArrays(mode, first, count);
+    return;
+}
+
+void core_renderer::draw_elements(const GLenum mode, const GLuint index_buffer, const int first, const int count,
+                                  const int last_vertex)
+{
+    if(count <= 0)
+        return;
+    bind_arrays(0, last_vertex+1);
+    prepare(mode, current_line_width, current_point_size, current_texture, false);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glDrawElements(mode, count, GL_UNSIGNED_INT, (GLvoid*) (first*sizeof(GLuint)));
+    return;
+}
+
+void core_renderer::draw_markers(const vector<GLfloat> & markers)
+{
+    int count = markers.size() / 8;
+    GLintptr offset;
+
+    if(count == 0)
+        return;
+    offset = stream(&markers[0], markers.size()*sizeof(GLfloat));
+    for(int i = 0; i < 3; i++)
+    {
+        const int sizes[3] = {3, 4, 1};
+        const int starts[3] = {0, 3, 7};
+        glVertexAttribPointer(3+i, sizes[i], GL_FLOAT, GL_FALSE, 8*sizeof(GLfloat),
+                              (GLvoid*) (offset + starts[i]*sizeof(GLfloat)));
+        glEnableVertexAttribArray(3+i);
+        glDisableVertexAttribArray(i);
+    }
+
+    // the viewport in the uniform buffer, then the marker program in place of the renderer's
+    prepare(GL_POINTS, current_line_width, current_point_size, 0, true);
+    glUseProgram(marker_program);
+    current_program = marker_program;
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    for(int i = 3; i < 6; i++)
+        glDisableVertexAttribArray(i);
+    return;
+}
+
+GLuint core_renderer::load_program(const char* vertex_source)
+{
+    return link_program(vertex_source, LINE_PRIMITIVES);
+}
+
+void core_renderer::use_program(const GLuint program)
+{
+    custom_program = program;
+    if(program != 0)
+    {
+        glUseProgram(program);
+        current_program = program;
+    }
+    return;
+}
+
+void core_renderer::prepare(const GLenum mode, const float line_width, const float point_size, const GLuint texture,
+                            const bool identity)
+{
+    primitive_class primitives = classify(mode);
+    GLuint program = custom_program != 0 ? custom_program : programs[primitives];
+    GLfloat transform[20];
+
+    if(matrices.version() != uploaded_version || identity != uploaded_identity ||
+       line_width != uploaded_sizes[0] || point_size != uploaded_sizes[1])
+    {
+        if(identity)
+        {
+            for(int i = 0; i < 16; i++)
+                transform[i] = (i % 5 == 0);
+        }
+        else
+        {
+            double pm[16];
+            multiply_matrix(matrices.top(GL_PROJECTION), matrices.top(GL_MODELVIEW), pm);
+            for(int i = 0; i < 16; i++)
+                transform[i] = pm[i];
+        }
+        transform[16] = width;
+        transform[17] = height;
+        transform[18] = line_width;
+        transform[19] = point_size;
+        glBindBuffer(GL_UNIFORM_BUFFER, transform_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(transform), transform);
+        uploaded_version = matrices.version();
+        uploaded_identity = identity;
+        uploaded_sizes[0] = line_width;
+        uploaded_sizes[1] = point_size;
+    }
+
+    if(program != current_program)
+    {
+        glUseProgram(program);
+        current_program = program;
+    }
+    if(custom_program == 0)
+        glUniform1i(textured_location[primitives], texture != 0);
+    // unbound otherwise, it may be the trail texture being drawn into
+    glBindTexture(GL_TEXTURE_2D, texture);
+    return;
+}
+
+GLintptr core_renderer::stream(const void* data, const GLsizeiptr size)
+{
+    GLintptr offset;
+    GLsizeiptr capacity = max(GLsizeiptr(STREAM_BUFFER_SIZE), size);
+
+    // a fresh store once full, the GL keeps the old one until its draws are done
+    glBindBuffer(GL_ARRAY_BUFFER, stream_buffer);
+    if(stream_offset + size > STREAM_BUFFER_SIZE)
+    {
+        glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+        stream_offset = 0;
+    }
+    offset = stream_offset;
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    stream_offset += (size + 15) / 16 * 16;
+    return offset;
+}
+
+void core_renderer::draw_quads(const int first, const int count)
+{
+    int num_indices = count / 4 * 6;
+
+    // two triangles per quad, shared by every quad drawn
+    if(num_indices > num_quad_indices)
+    {
+        vector<GLuint> indices(num_indices);
+        for(int q = 0; q < count/4; q++)
+        {
+            const GLuint corners[6] = {0, 1, 2, 0, 2, 3};
+            for(int i = 0; i < 6; i++)
+                indices[6*q+i] = 4*q + corners[i];
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_index_buffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, num_indices*sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+        num_quad_indices = num_indices;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_index_buffer);
+    glDrawElementsBaseVertex(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, (GLvoid*) 0, first);
+    return;
+}
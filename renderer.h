@@ -0,0 +1,245 @@
+/*
+ *  renderer.h
+ *  LorenzGL_verHY
+ *
+ *  How the drawing code reaches the GL: the fixed-function pipeline the
+ *  program was written for, or buffers and shaders in a core profile context.
+ *
+ */
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <vector>
+#include <string>
+#include <OpenGL/gl.h>
+#include "matrix_stack.h"
+
+using namespace std;
+
+// vertex shaders passed to load_program are written against both backends:
+// attributes position (vec3), color and tex_coord, the uniform mat4
+// projection_modelview, and they set gl_Position and vertex_color
+class renderer
+{
+public:
+    virtual ~renderer() {}
+
+    virtual const char* name() const = 0;
+
+    // of the drawing area, in pixels
+    virtual void set_viewport(const int width, const int height) = 0;
+
+    // immediate mode primitives, GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_TRIANGLES,
+    // GL_TRIANGLE_FAN or GL_QUADS, under the matrices current at end()
+    virtual void begin(const GLenum mode) = 0;
+    virtual void end() = 0;
+    virtual void vertex(const double x, const double y, const double z = 0.0) = 0;
+    virtual void color(const double r, const double g, const double b, const double a = 1.0) = 0;
+    void color(const double* rgba) {color(rgba[0], rgba[1], rgba[2], rgba[3]);}
+    virtual void tex_coord(const double s, const double t) = 0;
+    virtual void line_width(const double width) = 0;
+    virtual void point_size(const double size) = 0;
+    // modulates the color until texture(0)
+    virtual void texture(const GLuint texture) = 0;
+
+    // one line of HUD text in the current color, the baseline starting at (x, y)
+    virtual void text(const double x, const double y, const string & s) = 0;
+
+    // geometry recorded while it is drawn between begin_list and end_list, then
+    // redrawn by call_list under the matrices current at the call
+    virtual GLuint begin_list() = 0;
+    virtual void end_list() = 0;
+    virtual void call_list(const GLuint list) = 0;
+    virtual void delete_list(const GLuint list) = 0;
+
+    // GL_FLOAT arrays for draw_arrays and draw_elements, as glVertexPointer and friends:
+    // pointer is an offset into buffer, or client memory if buffer is 0; without a color
+    // array vertices take the current color
+    virtual void vertex_array(const GLuint buffer, const int size, const int stride, const void* pointer) = 0;
+    virtual void color_array(const GLuint buffer, const int size, const int stride, const void* pointer) = 0;
+    virtual void tex_coord_array(const GLuint buffer, const int size, const int stride, const void* pointer) = 0;
+    virtual void disable_arrays() = 0;
+    virtual void draw_arrays(const GLenum mode, const int first, const int count) = 0;
+    // count GL_UNSIGNED_INT indices from index first of index_buffer, none above last_vertex
+    virtual void draw_elements(const GLenum mode, const GLuint index_buffer, const int first, const int count,
+                               const int last_vertex) = 0;
+
+    // one smoothed point per marker, all of them in one draw: 8 floats per marker,
+    // the position in normalized device coordinates, rgba and the diameter in pixels
+    virtual void draw_markers(const vector<GLfloat> & markers) = 0;
+
+    // 0 if the shader does not build; core profile programs draw lines only
+    virtual GLuint load_program(const char* vertex_source) = 0;
+    // current for glUniform calls and drawing until use_program(0) returns to the
+    // renderer's own shading
+    virtual void use_program(const GLuint program) = 0;
+};
+
+// fixed-function pipeline and immediate mode, relies on matrices loading the GL matrices
+class legacy_renderer : public renderer
+{
+public:
+    legacy_renderer();
+    virtual ~legacy_renderer();
+
+    virtual const char* name() const {return "legacy";}
+    virtual void set_viewport(const int width, const int height) {}
+
+    virtual void begin(const GLenum mode);
+    virtual void end();
+    virtual void vertex(const double x, const double y, const double z = 0.0);
+    virtual void color(const double r, const double g, const double b, const double a = 1.0);
+    virtual void tex_coord(const double s, const double t);
+    virtual void line_width(const double width);
+    virtual void point_size(const double size);
+    virtual void texture(const GLuint texture);
+    virtual void text(const double x, const double y, const string & s);
+
+    virtual GLuint begin_list();
+    virtual void end_list();
+    virtual void call_list(const GLuint list);
+    virtual void delete_list(const GLuint list);
+
+    virtual void vertex_array(const GLuint buffer, const int size, const int stride, const void* pointer);
+    virtual void color_array(const GLuint buffer, const int size, const int stride, const void* pointer);
+    virtual void tex_coord_array(const GLuint buffer, const int size, const int stride, const void* pointer);
+    virtual void disable_arrays();
+    virtual void draw_arrays(const GLenum mode, const int first, const int count);
+    virtual void draw_elements(const GLenum mode, const GLuint index_buffer, const int first, const int count,
+                               const int last_vertex);
+    virtual void draw_markers(const vector<GLfloat> & markers);
+
+    virtual GLuint load_program(const char* vertex_source);
+    virtual void use_program(const GLuint program);
+
+private:
+    bool arrays[3]; // vertex, color, tex_coord arrays enabled
+    vector<unsigned char> glyphs; // glBitmap rows of hud_font.h, bottom first
+};
+
+// batches of the primitives in a batch, or of a recorded list
+struct core_batch
+{
+    GLenum mode;
+    int first;
+    int count;
+    float line_width;
+    float point_size;
+    GLuint texture;
+};
+
+struct core_list
+{
+    GLuint buffer;
+    vector<core_batch> batches;
+    bool deleted;
+};
+
+// OpenGL 3.3 core profile: one vertex array object, streamed vertex buffers, the
+// matrices and sizes in a uniform buffer; geometry shaders widen and smooth lines
+// and points, which a forward compatible context no longer does
+class core_renderer : public renderer
+{
+public:
+    core_renderer(const matrix_stack & matrices);
+    virtual ~core_renderer();
+
+    // false if the shaders do not build
+    bool init();
+
+    virtual const char* name() const {return "core";}
+    virtual void set_viewport(const int width, const int height);
+
+    virtual void begin(const GLenum mode);
+    virtual void end();
+    virtual void vertex(const double x, const double y, const double z = 0.0);
+    virtual void color(const double r, const double g, const double b, const double a = 1.0);
+    virtual void tex_coord(const double s, const double t);
+    virtual void line_width(const double width);
+    virtual void point_size(const double size);
+    virtual void texture(const GLuint texture);
+    virtual void text(const double x, const double y, const string & s);
+
+    virtual GLuint begin_list();
+    virtual void end_list();
+    virtual void call_list(const GLuint list);
+    virtual void delete_list(const GLuint list);
+
+    virtual void vertex_array(const GLuint buffer, const int size, const int stride, const void* pointer);
+    virtual void color_array(const GLuint buffer, const int size, const int stride, const void* pointer);
+    virtual void tex_coord_array(const GLuint buffer, const int size, const int stride, const void* pointer);
+    virtual void disable_arrays();
+    virtual void draw_arrays(const GLenum mode, const int first, const int count);
+    virtual void draw_elements(const GLenum mode, const GLuint index_buffer, const int first, const int count,
+                               const int last_vertex);
+    virtual void draw_markers(const vector<GLfloat> & markers);
+
+    virtual GLuint load_program(const char* vertex_source);
+    virtual void use_program(const GLuint program);
+
+private:
+    // an attribute array as set by vertex_array and friends
+    struct attribute_array
+    {
+        bool enabled;
+        GLuint buffer;
+        int size;
+        int stride;
+        const void* pointer;
+    };
+
+    enum primitive_class {LINE_PRIMITIVES, POINT_PRIMITIVES, TRIANGLE_PRIMITIVES};
+    static primitive_class classify(const GLenum mode);
+    GLuint link_program(const char* vertex_source, const primitive_class primitives);
+    void prepare(const GLenum mode, const float line_width, const float point_size, const GLuint texture,
+                 const bool identity);
+    void bind_arrays(const int first, const int count);
+    GLintptr stream(const void* data, const GLsizeiptr size);
+    void draw_quads(const int first, const int count);
+
+    const matrix_stack & matrices;
+    int width, height;
+
+    GLuint vertex_array_object;
+    GLuint stream_buffer;
+    GLsizeiptr stream_offset;
+    GLuint quad_index_buffer;
+    int num_quad_indices;
+    GLuint transform_buffer;
+    unsigned long uploaded_version;
+    bool uploaded_identity;
+    float uploaded_sizes[2];
+
+    // the renderer's own programs, by primitive class
+    GLuint programs[3];
+    GLint textured_location[3];
+    GLuint custom_program;
+    GLuint current_program;
+    GLuint marker_program; // instanced quads, one per marker
+
+    // immediate mode state; 9 floats per vertex: position, color, tex_coord
+    GLenum batch_mode;
+    vector<GLfloat> batch;
+    GLfloat current_color[4];
+    GLfloat current_tex_coord[2];
+    float current_line_width;
+    float current_point_size;
+    GLuint current_texture;
+
+    attribute_array arrays[3]; // position, color, tex_coord
+
+    GLuint font_texture;
+
+    // recorded geometry, list i+1 is lists[i]
+    vector<core_list> lists;
+    int recording;
+    vector<GLfloat> recorded;
+};
+
+// the current context has no fixed-function pipeline
+bool core_profile_context();
+
+// core_renderer if the current context is a core profile one, otherwise legacy_renderer
+renderer* create_renderer(matrix_stack & matrices);
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ *  skill_stats.cpp
+ *  LorenzGL_verHY
+ *
+ *  Running prediction skill, updated one (prediction, observation) pair at a time.
+ *
+ */
+
+#include "skill_stats.h"
+#include <math.h>
+
+void running_skill::reset()
+{
+    n = 0;
+    mean_pred = 0;
+    mean_obs = 0;
+    m2_pred = 0;
+    m2_obs = 0;
+    co_moment = 0;
+    abs_error = 0;
+    sq_error = 0;
+    return;
+}
+
+void running_skill::add(const double pred, const double obs)
+{
+    double d_pred, d_obs;
+
+    // skip frames without a prediction
+    if(pred != pred || obs != obs)
+        return;
+
+    n++;
+    d_pred = pred - mean_pred;
+    d_obs = obs - mean_obs;
+    mean_pred += d_pred / n;
+    mean_obs += d_obs / n;
+    m2_pred += d_pred * (pred - mean_pred);
+    m2_obs += d_obs * (obs - mean_obs);
+    co_moment += d_pred * (obs - mean_obs);
+    abs_error += fabs(pred - obs);
+    sq_error += (pred - obs) * (pred - obs);
+    return;
+}
+
+double running_skill::rho() const
+{
+    if(n < 2 || m2_pred <= 0 || m2_obs <= 0)
+        return 0;
+    return co_moment / sqrt(m2_pred * m2_obs);
+}
+
+double running_skill::rmse() const
+{
+    if(n == 0)
+        return 0;
+    return sqrt(sq_error / n);
+}
@@ -0,0 +1,36 @@
+/*
+ *  skill_stats.h
+ *  LorenzGL_verHY
+ *
+ *  Running prediction skill, updated one (prediction, observation) pair at a time.
+ *
+ */
+#ifndef SKILL_STATS_H
+#define SKILL_STATS_H
+
+class running_skill
+{
+public:
+    running_skill() {reset();}
+
+    void reset();
+    // Welford update of the means, variances and co-moment, O(1)
+    void add(const double pred, const double obs);
+
+    int count() const {return n;}
+    double rho() const;
+    double mae() const {return n > 0 ? abs_error / n : 0;}
+    double rmse() const;
+
+private:
+    int n;
+    double mean_pred;
+    double mean_obs;
+    double m2_pred;   // sum of squared deviations of pred
+    double m2_obs;    // sum of squared deviations of obs
+    double co_moment; // sum of (pred - mean_pred) * (obs - mean_obs)
+    double abs_error;
+    double sq_error;
+};
+
+#endif
@@ -0,0 +1,480 @@
+/*
+ *  surrogate.cpp
+ *  LorenzGL_verHY
+ *
+ *  Surrogate series and significance tests for cross map skill.
+ *
+ */
+
+#include "surrogate.h"
+#include "parallel.h"
+#include <algorithm>
+#include <map>
+
+#define SURROGATE_BLOCK 16 // surrogates per work item
+#define TWIN_RECURRENCE_RATE 0.05
+#define TWIN_BLOCK 64 // embedded points per work item of the twin search
+
+// splitmix64, small and good enough to give every surrogate its own stream
+static unsigned long long next_random(unsigned long long & state)
+{
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double uniform(unsigned long long & state)
+{
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int uniform_int(unsigned long long & state, const int n)
+{
+    return int(next_random(state) % (unsigned long long)n);
+}
+
+// in place iterative radix-2 transform, a.size() must be a power of 2
+static void fft(vector<complex<double> > & a, const bool inverse)
+{
+    const int n = a.size();
+
+    for(int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+            swap(a[i], a[j]);
+    }
+    for(int len = 2; len <= n; len <<= 1)
+    {
+        double angle = 2 * M_PI / len * (inverse ? 1 : -1);
+        complex<double> w_len(cos(angle), sin(angle));
+        for(int i = 0; i < n; i += len)
+        {
+            complex<double> w(1);
+            for(int j = 0; j < len/2; j++)
+            {
+                complex<double> u = a[i+j];
+                complex<double> v = a[i+j+len/2] * w;
+                a[i+j] = u + v;
+                a[i+j+len/2] = u - v;
+                w *= w_len;
+            }
+        }
+    }
+    return;
+}
+
+// the recurrence neighborhoods of the embedded points; every row is a scan over
+// all points, only its hash is kept
+struct twin_job
+{
+    const double* x; // first embedded point
+    int E, tau, num;
+    double delta;
+    vector<unsigned long long> hashes;
+    vector<vector<int> > buckets;    // points by hash, ascending
+    vector<vector<int> > subgroups;  // per bucket, the twin group of each point within it
+};
+
+static inline bool recurrent(const twin_job* job, const int p, const int q)
+{
+    for(int e = 0; e < job->E; e++)
+    {
+        if(fabs(job->x[p - e*job->tau] - job->x[q - e*job->tau]) > job->delta)
+            return false;
+    }
+    return true;
+}
+
+static void hash_twin_rows(const int block, void* arg)
+{
+    twin_job* job = (twin_job*) arg;
+    int last = min((block+1) * TWIN_BLOCK, job->num);
+
+    // FNV-1a over the neighbor indices
+    for(int p = block * TWIN_BLOCK; p < last; p++)
+    {
+        unsigned long long h = 14695981039346656037ULL;
+        for(int q = 0; q < job->num; q++)
+        {
+            if(recurrent(job, p, q))
+                h = (h ^ (unsigned long long)q) * 1099511628211ULL;
+        }
+        job->hashes[p] = h;
+    }
+    return;
+}
+
+static void split_twin_bucket(const int b, void* arg)
+{
+    twin_job* job = (twin_job*) arg;
+    const vector<int> & bucket = job->buckets[b];
+    vector<int> & subgroup = job->subgroups[b];
+    vector<int> firsts; // first point of every twin group in the bucket
+
+    // equal hashes almost always mean equal neighborhoods, the rows are compared
+    // again to split the rare collisions
+    subgroup.resize(bucket.size());
+    for(int i = 0; i < bucket.size(); i++)
+    {
+        int g = 0;
+        for(; g < firsts.size(); g++)
+        {
+            int q = 0;
+            for(; q < job->num; q++)
+            {
+                if(recurrent(job, bucket[i], q) != recurrent(job, firsts[g], q))
+                    break;
+            }
+            if(q == job->num)
+                break;
+        }
+        if(g == firsts.size())
+            firsts.push_back(bucket[i]);
+        subgroup[i] = g;
+    }
+    return;
+}
+
+dft_plan::dft_plan(const int n)
+{
+    this->n = n;
+    m = 0;
+    if(n < 1 || (n & (n-1)) == 0)
+        return;
+
+    // X_k = conj(c_k) * sum_j (x_j conj(c_j)) c_(k-j) with c_k = exp(i pi k^2 / n)
+    m = 1;
+    while(m < 2*n - 1)
+        m *= 2;
+    chirp.resize(n);
+    for(int k = 0; k < n; k++)
+    {
+        double angle = M_PI * double((long long)k * k % (2LL * n)) / n;
+        chirp[k] = complex<double>(cos(angle), sin(angle));
+    }
+    chirp_fft.assign(m, 0);
+    for(int k = 0; k < n; k++)
+    {
+        chirp_fft[k] = chirp[k];
+        if(k > 0)
+            chirp_fft[m-k] = chirp[k];
+    }
+    fft(chirp_fft, false);
+}
+
+void dft_plan::forward(vector<complex<double> > & a) const
+{
+    if(m == 0)
+    {
+        fft(a, false);
+        return;
+    }
+
+    vector<complex<double> > b(m, 0);
+    for(int k = 0; k < n; k++)
+        b[k] = a[k] * conj(chirp[k]);
+    fft(b, false);
+    for(int k = 0; k < m; k++)
+        b[k] *= chirp_fft[k];
+    fft(b, true);
+    for(int k = 0; k < n; k++)
+        a[k] = conj(chirp[k]) * b[k] / double(m);
+    return;
+}
+
+void dft_plan::inverse(vector<complex<double> > & a) const
+{
+    for(int k = 0; k < n; k++)
+        a[k] = conj(a[k]);
+    forward(a);
+    for(int k = 0; k < n; k++)
+        a[k] = conj(a[k]) / double(n);
+    return;
+}
+
+surrogate_generator::surrogate_generator(const vector<double> & ts, const surrogate_type type,
+                                         const int E, const int tau, const int num_threads) : ts(ts)
+{
+    int n = ts.size();
+
+    this->type = type;
+    start = (E-1)*tau;
+    plan = NULL;
+
+    if(type == SURR_FOURIER)
+    {
+        spectrum.assign(ts.begin(), ts.end());
+        plan = new dft_plan(n);
+        plan->forward(spectrum);
+    }
+    else if(type == SURR_TWIN && n > start)
+    {
+        // twins are embedded points with the same recurrence neighborhood (max norm
+        // within delta); the rows are quadratic in the number of points, so they are
+        // hashed in parallel and points are grouped by hash
+        twin_job job;
+        vector<double> distances;
+        map<unsigned long long, int> bucket_index;
+        vector<int> point_bucket, point_subgroup;
+        vector<vector<int> > group_ids, members;
+        unsigned long long state = 12345;
+        double d;
+
+        job.x = &ts[start];
+        job.E = E;
+        job.tau = tau;
+        job.num = n - start;
+
+        // pick delta for the wanted recurrence rate from a sample of pairs
+        for(int i = 0; i < 20000 && job.num > 1; i++)
+        {
+            int p = uniform_int(state, job.num), q = uniform_int(state, job.num);
+            d = 0;
+            for(int e = 0; e < E; e++)
+                d = max(d, fabs(job.x[p - e*tau] - job.x[q - e*tau]));
+            distances.push_back(d);
+        }
+        job.delta = 0;
+        if(distances.size() > 0)
+        {
+            nth_element(distances.begin(), distances.begin() + int(TWIN_RECURRENCE_RATE * distances.size()), distances.end());
+            job.delta = distances[int(TWIN_RECURRENCE_RATE * distances.size())];
+        }
+
+        job.hashes.resize(job.num);
+        parallel_for((job.num + TWIN_BLOCK - 1) / TWIN_BLOCK, hash_twin_rows, &job, num_threads);
+        point_bucket.resize(job.num);
+        for(int p = 0; p < job.num; p++)
+        {
+            map<unsigned long long, int>::iterator b = bucket_index.find(job.hashes[p]);
+            if(b == bucket_index.end())
+            {
+                b = bucket_index.insert(make_pair(job.hashes[p], int(job.buckets.size()))).first;
+                job.buckets.push_back(vector<int>());
+            }
+            point_bucket[p] = b->second;
+            job.buckets[b->second].push_back(p);
+        }
+        job.subgroups.resize(job.buckets.size());
+        parallel_for(job.buckets.size(), split_twin_bucket, &job, num_threads);
+
+        // groups numbered in the order of their first point
+        point_subgroup.resize(job.num);
+        group_ids.resize(job.buckets.size());
+        for(int b = 0; b < job.buckets.size(); b++)
+        {
+            for(int i = 0; i < job.buckets[b].size(); i++)
+                point_subgroup[job.buckets[b][i]] = job.subgroups[b][i];
+        }
+        twin_group.resize(job.num);
+        for(int p = 0; p < job.num; p++)
+        {
+            vector<int> & ids = group_ids[point_bucket[p]];
+            int sub = point_subgroup[p];
+            if(sub >= ids.size())
+                ids.resize(sub+1, -1);
+            if(ids[sub] < 0)
+            {
+                ids[sub] = members.size();
+                members.push_back(vector<int>());
+            }
+            twin_group[p] = ids[sub];
+            members[ids[sub]].push_back(p);
+        }
+
+        twin_start.push_back(0);
+        for(int g = 0; g < members.size(); g++)
+        {
+            twin_list.insert(twin_list.end(), members[g].begin(), members[g].end());
+            twin_start.push_back(twin_list.size());
+        }
+    }
+}
+
+surrogate_generator::~surrogate_generator()
+{
+    delete plan;
+}
+
+void surrogate_generator::generate(const unsigned long long seed, vector<double> & surr) const
+{
+    int n = ts.size();
+    unsigned long long state = seed;
+
+    surr.resize(n);
+    switch(type)
+    {
+        case SURR_SHUFFLE:
+            surr = ts;
+            for(int i = n-1; i > 0; i--)
+                swap(surr[i], surr[uniform_int(state, i+1)]);
+            break;
+        case SURR_FOURIER:
+        {
+            // same amplitudes, random phases, kept conjugate symmetric so the result is real;
+            // the mean and the Nyquist term are real and keep their sign
+            vector<complex<double> > a(n);
+            a[0] = spectrum[0];
+            for(int k = 1; 2*k < n; k++)
+            {
+                a[k] = polar(abs(spectrum[k]), 2 * M_PI * uniform(state));
+                a[n-k] = conj(a[k]);
+            }
+            if(n % 2 == 0 && n > 0)
+                a[n/2] = spectrum[n/2];
+            plan->inverse(a);
+            for(int i = 0; i < n; i++)
+                surr[i] = a[i].real();
+            break;
+        }
+        case SURR_TWIN:
+        {
+            // walk the embedded trajectory, jumping to a random twin before each step
+            int num = twin_group.size(), p, g;
+            if(num < 2)
+            {
+                surr = ts;
+                break;
+            }
+            p = uniform_int(state, num);
+            for(int i = 0; i < n; i++)
+            {
+                surr[i] = ts[p + start];
+                g = twin_group[p];
+                p = twin_list[twin_start[g] + uniform_int(state, twin_start[g+1] - twin_start[g])] + 1;
+                if(p >= num)
+                    p = uniform_int(state, num);
+            }
+            break;
+        }
+    }
+    return;
+}
+
+surrogate_test::surrogate_test(const vector<vector<double> > & series, const int E, const int tau,
+                               const int nn_num, const int nn_skip, const surrogate_type type,
+                               const int num_surrogates, const unsigned long long seed) : series(series)
+{
+    num_vars = series.size();
+    this->E = E;
+    this->tau = tau;
+    this->nn_num = nn_num;
+    this->nn_skip = nn_skip;
+    this->type = type;
+    this->num_surrogates = num_surrogates;
+    this->seed = seed;
+    skill.resize(num_vars * num_vars, 0);
+    exceed_count.resize(num_vars * num_vars, 0);
+    num_workers = 0;
+}
+
+surrogate_test::~surrogate_test()
+{
+    for(int i = 0; i < generators.size(); i++)
+        delete generators[i];
+}
+
+void surrogate_test::build_library(const int lib, void* arg)
+{
+    surrogate_test* test = (surrogate_test*) arg;
+    nn_table & table = test->tables[lib];
+    vector<double> pred(test->series[lib].size());
+
+    build_nn_table(test->series[lib], test->E, test->tau, test->nn_num, test->nn_skip, table);
+    for(int target = 0; target < test->num_vars; target++)
+    {
+        xmap(table, test->series[target], pred);
+        test->skill[lib * test->num_vars + target] = pearson(pred, test->series[target], table.first, table.num_points);
+    }
+    return;
+}
+
+void surrogate_test::test_worker(const int worker, void* arg)
+{
+    surrogate_test* test = (surrogate_test*) arg;
+    int num_vars = test->num_vars;
+    int blocks_per_target = (test->num_surrogates + SURROGATE_BLOCK - 1) / SURROGATE_BLOCK;
+    int* count = &test->partial_count[0] + worker * num_vars * num_vars;
+    vector<double> surr, pred;
+
+    // workers take every num_workers-th block and count into their own slice
+    for(int block = worker; block < num_vars * blocks_per_target; block += test->num_workers)
+    {
+        int target = block / blocks_per_target;
+        int first = (block % blocks_per_target) * SURROGATE_BLOCK;
+        int last = min(first + SURROGATE_BLOCK, test->num_surrogates);
+
+        // each surrogate of the target is drawn once and cross mapped from every library
+        pred.resize(test->series[target].size());
+        for(int s = first; s < last; s++)
+        {
+            unsigned long long state = test->seed * 1000003ULL + (unsigned long long)target * test->num_surrogates + s;
+            test->generators[target]->generate(next_random(state), surr);
+            for(int lib = 0; lib < num_vars; lib++)
+            {
+                const nn_table & table = test->tables[lib];
+                xmap(table, surr, pred);
+                if(pearson(pred, surr, table.first, table.num_points) >= test->get_skill(lib, target))
+                    count[lib * num_vars + target]++;
+            }
+        }
+    }
+    return;
+}
+
+void surrogate_test::compute(const int num_threads)
+{
+    for(int i = 1; i < num_vars; i++)
+    {
+        if(series[i].size() != series[0].size())
+        {
+            cerr << "ERROR (surrogate_test): series " << i << " has " << series[i].size()
+                 << " points, expected " << series[0].size() << ".\n";
+            exit(1);
+        }
+    }
+
+    // the twin search is parallel within each generator
+    generators.assign(num_vars, (surrogate_generator*) NULL);
+    for(int target = 0; target < num_vars; target++)
+        generators[target] = new surrogate_generator(series[target], type, E, tau, num_threads);
+    tables.resize(num_vars);
+    parallel_for(num_vars, build_library, this, num_threads);
+
+    // one exceedance count per pair, from per-worker partial counts
+    num_workers = (num_threads > 0) ? num_threads : num_cores();
+    num_workers = max(1, min(num_workers, num_vars * ((num_surrogates + SURROGATE_BLOCK - 1) / SURROGATE_BLOCK)));
+    partial_count.assign(num_workers * num_vars * num_vars, 0);
+    parallel_for(num_workers, test_worker, this, num_workers);
+    exceed_count.assign(num_vars * num_vars, 0);
+    for(int w = 0; w < num_workers; w++)
+        for(int i = 0; i < num_vars * num_vars; i++)
+            exceed_count[i] += partial_count[w * num_vars * num_vars + i];
+    vector<int>().swap(partial_count);
+    return;
+}
+
+double surrogate_test::get_p_value(const int lib, const int target) const
+{
+    return (1.0 + exceed_count[lib * num_vars + target]) / (1.0 + num_surrogates);
+}
+
+void surrogate_test::write(ostream & out) const
+{
+    for(int lib = 0; lib < num_vars; lib++)
+    {
+        for(int target = 0; target < num_vars; target++)
+        {
+            if(target > 0)
+                out << ",";
+            out << get_p_value(lib, target);
+        }
+        out << "\n";
+    }
+    return;
+}
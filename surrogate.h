@@ -0,0 +1,99 @@
+/*
+ *  surrogate.h
+ *  LorenzGL_verHY
+ *
+ *  Surrogate series and significance tests for cross map skill.
+ *
+ */
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include "ccm.h"
+#include <complex>
+
+using namespace std;
+
+enum surrogate_type {SURR_SHUFFLE, SURR_FOURIER, SURR_TWIN};
+
+// discrete Fourier transform of a fixed length, radix-2 when n is a power of 2 and
+// Bluestein's chirp z-transform otherwise
+class dft_plan
+{
+public:
+    dft_plan(const int n);
+
+    // unnormalized; the inverse is scaled by 1/n
+    void forward(vector<complex<double> > & a) const;
+    void inverse(vector<complex<double> > & a) const;
+
+private:
+    int n;
+    int m; // size of the radix-2 convolution, 0 if n is a power of 2
+    vector<complex<double> > chirp;
+    vector<complex<double> > chirp_fft;
+};
+
+// draws surrogates of one series; everything that does not depend on the random
+// numbers (spectrum, twins) is computed once in the constructor
+class surrogate_generator
+{
+public:
+    // E and tau are the embedding used to find twins, on num_threads threads (0 = all cores)
+    surrogate_generator(const vector<double> & ts, const surrogate_type type,
+                        const int E = 3, const int tau = 1, const int num_threads = 0);
+    ~surrogate_generator();
+
+    // surr gets ts.size() values, the same seed gives the same surrogate
+    void generate(const unsigned long long seed, vector<double> & surr) const;
+
+private:
+    const vector<double> & ts;
+    surrogate_type type;
+    int start;               // (E-1)*tau, first embedded point
+    dft_plan* plan;
+    vector<complex<double> > spectrum; // DFT(ts)
+    vector<int> twin_start;   // twins of embedded point p are twin_list[twin_start[twin_group[p]] ...]
+    vector<int> twin_list;
+    vector<int> twin_group;
+};
+
+// p-values of every "lib xmap target" skill against surrogates of the target; the
+// neighbor table of each library is built once and shared by all surrogates
+class surrogate_test
+{
+public:
+    surrogate_test(const vector<vector<double> > & series, const int E, const int tau,
+                   const int nn_num, const int nn_skip, const surrogate_type type,
+                   const int num_surrogates, const unsigned long long seed = 1);
+    ~surrogate_test();
+
+    void compute(const int num_threads = 0);
+
+    double get_skill(const int lib, const int target) const {return skill[lib * num_vars + target];}
+    // (1 + number of surrogates with skill >= the real one) / (1 + num_surrogates)
+    double get_p_value(const int lib, const int target) const;
+    int size() const {return num_vars;}
+    void write(ostream & out) const; // p-values, row = library, column = target
+
+private:
+    static void build_library(const int lib, void* arg);
+    static void test_worker(const int worker, void* arg);
+
+    const vector<vector<double> > & series;
+    int num_vars;
+    int E;
+    int tau;
+    int nn_num;
+    int nn_skip;
+    surrogate_type type;
+    int num_surrogates;
+    unsigned long long seed;
+    vector<surrogate_generator*> generators;
+    vector<nn_table> tables;
+    vector<double> skill;
+    vector<int> exceed_count; // [lib * num_vars + target], surrogates with skill >= the real one
+    int num_workers;
+    vector<int> partial_count; // [(worker * num_vars + lib) * num_vars + target], merged into exceed_count
+};
+
+#endif